@@ -29,6 +29,7 @@ PyObject *PyEntry_LazyInit(PyFunctionObject *func,
                            PyObject *kwnames);
 
 void PyEntry_init(PyFunctionObject *func);
+void PyEntry_initnow(PyFunctionObject *func);
 /* FB_entry_END */
 
 struct PyFunctionObject {
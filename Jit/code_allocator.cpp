@@ -5,7 +5,9 @@
 
 #include <sys/mman.h>
 
+#include <algorithm>
 #include <cstring>
+#include <iterator>
 
 using namespace jit::codegen;
 
@@ -16,15 +18,22 @@ const size_t kAllocSize = 1024 * 1024 * 2;
 
 CodeAllocator* CodeAllocator::s_global_code_allocator_ = nullptr;
 
-std::vector<void*> CodeAllocatorCinder::s_allocations_{};
+std::map<uint8_t*, size_t> CodeAllocatorCinder::s_allocations_{};
+std::map<uint8_t*, size_t> CodeAllocatorCinder::s_live_allocs_{};
+std::map<uint8_t*, size_t> CodeAllocatorCinder::s_free_blocks_{};
 uint8_t* CodeAllocatorCinder::s_current_alloc_ = nullptr;
 size_t CodeAllocatorCinder::s_current_alloc_free_ = 0;
 
 size_t CodeAllocatorCinder::s_used_bytes_ = 0;
+size_t CodeAllocatorCinder::s_live_bytes_ = 0;
+size_t CodeAllocatorCinder::s_freed_bytes_ = 0;
 size_t CodeAllocatorCinder::s_lost_bytes_ = 0;
 size_t CodeAllocatorCinder::s_huge_allocs_ = 0;
 size_t CodeAllocatorCinder::s_fragmented_allocs_ = 0;
 
+// Guards the CodeAllocatorCinder statics during multithreaded compile.
+static ThreadedCompileLock s_cinder_alloc_lock;
+
 CodeAllocator::~CodeAllocator() {}
 
 void CodeAllocator::makeGlobalCodeAllocator() {
@@ -46,14 +55,19 @@ void CodeAllocator::freeGlobalCodeAllocator() {
 }
 
 CodeAllocatorCinder::~CodeAllocatorCinder() {
-  for (void* alloc : s_allocations_) {
-    JIT_CHECK(munmap(alloc, kAllocSize) == 0, "Freeing code memory failed");
+  for (auto& alloc : s_allocations_) {
+    JIT_CHECK(
+        munmap(alloc.first, alloc.second) == 0, "Freeing code memory failed");
   }
   s_allocations_.clear();
+  s_live_allocs_.clear();
+  s_free_blocks_.clear();
   s_current_alloc_ = nullptr;
   s_current_alloc_free_ = 0;
 
   s_used_bytes_ = 0;
+  s_live_bytes_ = 0;
+  s_freed_bytes_ = 0;
   s_lost_bytes_ = 0;
   s_huge_allocs_ = 0;
   s_fragmented_allocs_ = 0;
@@ -62,7 +76,7 @@ CodeAllocatorCinder::~CodeAllocatorCinder() {
 asmjit::Error CodeAllocatorCinder::addCode(
     void** dst,
     asmjit::CodeHolder* code) noexcept {
-  ThreadedCompileSerialize guard;
+  std::lock_guard<ThreadedCompileLock> guard{s_cinder_alloc_lock};
 
   *dst = nullptr;
 
@@ -70,9 +84,60 @@ asmjit::Error CodeAllocatorCinder::addCode(
   ASMJIT_PROPAGATE(code->resolveUnresolvedLinks());
 
   size_t max_code_size = code->codeSize();
+  uint8_t* base = allocFromFreeList(max_code_size);
+  bool from_free_list = base != nullptr;
+  if (from_free_list) {
+    ASMJIT_PROPAGATE(code->relocateToBase(uintptr_t(base)));
+  } else {
+    ASMJIT_PROPAGATE(allocFromChunk(code, max_code_size, &base));
+  }
+
+  size_t actual_code_size = code->codeSize();
+  JIT_CHECK(actual_code_size <= max_code_size, "Code grew during relocation");
+
+  for (asmjit::Section* section : code->_sections) {
+    size_t offset = section->offset();
+    size_t buffer_size = section->bufferSize();
+    size_t virtual_size = section->virtualSize();
+
+    JIT_CHECK(
+        offset + buffer_size <= actual_code_size, "Inconsistent code size");
+    std::memcpy(base + offset, section->data(), buffer_size);
+
+    if (virtual_size > buffer_size) {
+      JIT_CHECK(
+          offset + virtual_size <= actual_code_size, "Inconsistent code size");
+      std::memset(base + offset + buffer_size, 0, virtual_size - buffer_size);
+    }
+  }
+
+  *dst = base;
+
+  if (!from_free_list) {
+    s_current_alloc_ += actual_code_size;
+    s_current_alloc_free_ -= actual_code_size;
+  } else if (actual_code_size < max_code_size) {
+    // Return whatever relocation didn't need from the free block we used.
+    addFreeBlock(base + actual_code_size, max_code_size - actual_code_size);
+  }
+  s_live_allocs_.emplace(base, actual_code_size);
+  s_used_bytes_ += actual_code_size;
+  s_live_bytes_ += actual_code_size;
+
+  return asmjit::kErrorOk;
+}
+
+asmjit::Error CodeAllocatorCinder::allocFromChunk(
+    asmjit::CodeHolder* code,
+    size_t max_code_size,
+    uint8_t** base) noexcept {
   size_t alloc_size = ((max_code_size / kAllocSize) + 1) * kAllocSize;
   if (s_current_alloc_free_ < max_code_size) {
     s_lost_bytes_ += s_current_alloc_free_;
+    if (s_current_alloc_free_ > 0) {
+      addFreeBlock(s_current_alloc_, s_current_alloc_free_);
+      s_current_alloc_free_ = 0;
+    }
     void* res = mmap(
         NULL,
         alloc_size,
@@ -94,41 +159,107 @@ asmjit::Error CodeAllocatorCinder::addCode(
       s_huge_allocs_++;
     }
     s_current_alloc_ = static_cast<uint8_t*>(res);
-    s_allocations_.emplace_back(res);
+    s_allocations_.emplace(s_current_alloc_, alloc_size);
     s_current_alloc_free_ = alloc_size;
   }
 
-  ASMJIT_PROPAGATE(code->relocateToBase(uintptr_t(s_current_alloc_)));
+  *base = s_current_alloc_;
+  return code->relocateToBase(uintptr_t(s_current_alloc_));
+}
 
-  size_t actual_code_size = code->codeSize();
-  JIT_CHECK(actual_code_size <= max_code_size, "Code grew during relocation");
+void CodeAllocatorCinder::releaseCode(void* addr) {
+  std::lock_guard<ThreadedCompileLock> guard{s_cinder_alloc_lock};
 
-  for (asmjit::Section* section : code->_sections) {
-    size_t offset = section->offset();
-    size_t buffer_size = section->bufferSize();
-    size_t virtual_size = section->virtualSize();
+  auto it = s_live_allocs_.upper_bound(static_cast<uint8_t*>(addr));
+  JIT_CHECK(it != s_live_allocs_.begin(), "Releasing unknown code %p", addr);
+  --it;
+  uint8_t* start = it->first;
+  size_t size = it->second;
+  JIT_CHECK(
+      static_cast<uint8_t*>(addr) < start + size,
+      "Releasing unknown code %p",
+      addr);
+  s_live_allocs_.erase(it);
+  s_live_bytes_ -= size;
+  addFreeBlock(start, size);
+}
 
-    JIT_CHECK(
-        offset + buffer_size <= actual_code_size, "Inconsistent code size");
-    std::memcpy(s_current_alloc_ + offset, section->data(), buffer_size);
+size_t CodeAllocatorCinder::fragmentedBytes() {
+  std::lock_guard<ThreadedCompileLock> guard{s_cinder_alloc_lock};
+  size_t largest = 0;
+  for (auto& block : s_free_blocks_) {
+    largest = std::max(largest, block.second);
+  }
+  return s_freed_bytes_ - largest;
+}
 
-    if (virtual_size > buffer_size) {
-      JIT_CHECK(
-          offset + virtual_size <= actual_code_size, "Inconsistent code size");
-      std::memset(
-          s_current_alloc_ + offset + buffer_size,
-          0,
-          virtual_size - buffer_size);
+uint8_t* CodeAllocatorCinder::allocFromFreeList(size_t size) {
+  auto best = s_free_blocks_.end();
+  for (auto it = s_free_blocks_.begin(); it != s_free_blocks_.end(); ++it) {
+    if (it->second >= size &&
+        (best == s_free_blocks_.end() || it->second < best->second)) {
+      best = it;
+      if (best->second == size) {
+        break;
+      }
     }
   }
+  if (best == s_free_blocks_.end()) {
+    return nullptr;
+  }
+  uint8_t* start = best->first;
+  size_t remaining = best->second - size;
+  s_free_blocks_.erase(best);
+  if (remaining > 0) {
+    s_free_blocks_.emplace(start + size, remaining);
+  }
+  s_freed_bytes_ -= size;
+  return start;
+}
 
-  *dst = s_current_alloc_;
+void CodeAllocatorCinder::addFreeBlock(uint8_t* start, size_t size) {
+  s_freed_bytes_ += size;
 
-  s_current_alloc_ += actual_code_size;
-  s_current_alloc_free_ -= actual_code_size;
-  s_used_bytes_ += actual_code_size;
+  auto chunk = std::prev(s_allocations_.upper_bound(start));
+  uint8_t* chunk_start = chunk->first;
+  uint8_t* chunk_end = chunk_start + chunk->second;
 
-  return asmjit::kErrorOk;
+  // Coalesce with the following and preceding blocks, as long as they're in
+  // the same chunk.
+  auto next = s_free_blocks_.lower_bound(start);
+  if (next != s_free_blocks_.end() && next->first == start + size &&
+      next->first < chunk_end) {
+    size += next->second;
+    next = s_free_blocks_.erase(next);
+  }
+  if (next != s_free_blocks_.begin()) {
+    auto prev = std::prev(next);
+    if (prev->first >= chunk_start && prev->first + prev->second == start) {
+      start = prev->first;
+      size += prev->second;
+      s_free_blocks_.erase(prev);
+    }
+  }
+
+  // A block that ends where the current chunk's unused tail starts just
+  // extends the tail.
+  if (start + size == s_current_alloc_ && s_current_alloc_ < chunk_end) {
+    s_current_alloc_ = start;
+    s_current_alloc_free_ += size;
+    s_freed_bytes_ -= size;
+    return;
+  }
+
+  // The current chunk's unused tail isn't on the free list, so only other
+  // chunks can become entirely free.
+  if (start == chunk_start && size == chunk->second) {
+    JIT_CHECK(
+        munmap(chunk_start, chunk->second) == 0, "Freeing code memory failed");
+    s_freed_bytes_ -= size;
+    s_allocations_.erase(chunk);
+    return;
+  }
+  s_free_blocks_.emplace(start, size);
 }
 
 MultipleSectionCodeAllocator::~MultipleSectionCodeAllocator() {
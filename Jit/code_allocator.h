@@ -5,6 +5,7 @@
 #include "Jit/codegen/code_section.h"
 #include "Jit/log.h"
 
+#include <map>
 #include <memory>
 #include <vector>
 
@@ -47,6 +48,11 @@ class CodeAllocator {
       void** dst,
       asmjit::CodeHolder* code) noexcept = 0;
 
+  // Give back the allocation containing addr so its memory can be reused. The
+  // caller must guarantee that no thread is executing that code or will return
+  // into it. Allocators which can't reuse memory ignore this.
+  virtual void releaseCode(void* /* addr */) {}
+
  protected:
   std::unique_ptr<asmjit::JitRuntime> _runtime{
       std::make_unique<asmjit::JitRuntime>()};
@@ -66,16 +72,39 @@ class CodeAllocatorAsmJit : public CodeAllocator {
 };
 
 // A code allocator which tries to allocate all code on huge pages.
+//
+// Released code goes on an address-ordered free list, where adjacent blocks
+// are coalesced. New code is placed in the smallest free block that fits
+// before falling back to bumping through the current chunk, which keeps live
+// code packed into as few chunks as possible. A chunk whose memory is entirely
+// free, other than the current chunk, is returned to the OS.
 class CodeAllocatorCinder : public CodeAllocator {
  public:
   virtual ~CodeAllocatorCinder();
 
   asmjit::Error addCode(void** dst, asmjit::CodeHolder* code) noexcept override;
 
+  void releaseCode(void* addr) override;
+
+  // Total bytes of code ever allocated.
   static size_t usedBytes() {
     return s_used_bytes_;
   }
 
+  // Bytes of code currently allocated and not released.
+  static size_t liveBytes() {
+    return s_live_bytes_;
+  }
+
+  // Bytes on the free list, available for reuse.
+  static size_t freedBytes() {
+    return s_freed_bytes_;
+  }
+
+  // Bytes on the free list outside of the largest free block. These can only
+  // be reused by code smaller than the block they're in.
+  static size_t fragmentedBytes();
+
   static size_t lostBytes() {
     return s_lost_bytes_;
   }
@@ -89,8 +118,25 @@ class CodeAllocatorCinder : public CodeAllocator {
   }
 
  private:
-  // List of chunks allocated for use in deallocation
-  static std::vector<void*> s_allocations_;
+  // Relocate code to the start of the current chunk's unused tail, allocating
+  // a new chunk first if the tail is smaller than max_code_size.
+  static asmjit::Error allocFromChunk(
+      asmjit::CodeHolder* code,
+      size_t max_code_size,
+      uint8_t** base) noexcept;
+  // Carve size bytes out of the best-fitting free block, or return nullptr if
+  // no free block is large enough.
+  static uint8_t* allocFromFreeList(size_t size);
+  // Put a block on the free list, coalescing it with its neighbors within the
+  // same chunk, and unmap the chunk if it's now entirely free.
+  static void addFreeBlock(uint8_t* start, size_t size);
+
+  // Chunks allocated from the OS, mapping start address to size.
+  static std::map<uint8_t*, size_t> s_allocations_;
+  // Live code allocations, mapping start address to size.
+  static std::map<uint8_t*, size_t> s_live_allocs_;
+  // Free blocks available for reuse, mapping start address to size.
+  static std::map<uint8_t*, size_t> s_free_blocks_;
 
   // Pointer to next free address in the current chunk
   static uint8_t* s_current_alloc_;
@@ -98,8 +144,11 @@ class CodeAllocatorCinder : public CodeAllocator {
   static size_t s_current_alloc_free_;
 
   static size_t s_used_bytes_;
-  // Number of bytes in total lost when allocations didn't fit neatly into
-  // the bytes remaining in a chunk so a new one was allocated.
+  static size_t s_live_bytes_;
+  static size_t s_freed_bytes_;
+  // Number of bytes in total left over when allocations didn't fit neatly into
+  // the bytes remaining in a chunk so a new one was allocated. These bytes go
+  // on the free list.
   static size_t s_lost_bytes_;
   // Number of chunks allocated (= to number of huge pages used)
   static size_t s_huge_allocs_;
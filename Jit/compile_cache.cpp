@@ -0,0 +1,225 @@
+// Copyright (c) Facebook, Inc. and its affiliates. (http://www.facebook.com)
+#include "Jit/compile_cache.h"
+
+#include "Jit/log.h"
+#include "Jit/profile_data.h"
+#include "Jit/util.h"
+
+#include <unistd.h>
+
+#include <cstdio>
+#include <fstream>
+#include <type_traits>
+
+namespace jit {
+
+namespace {
+
+const uint64_t kMagicHeader = 0x6568636163746a;
+const uint32_t kVersion = 1;
+
+#if __BYTE_ORDER__ != __ORDER_LITTLE_ENDIAN__
+#error Integers in compile cache files are little endian.
+#endif
+
+template <typename T>
+T readValue(std::istream& stream) {
+  static_assert(
+      std::is_trivially_copyable_v<T>, "T must be trivially copyable");
+  T val;
+  stream.read(reinterpret_cast<char*>(&val), sizeof(val));
+  return val;
+}
+
+template <typename T>
+void writeValue(std::ostream& stream, T value) {
+  static_assert(
+      std::is_trivially_copyable_v<T>, "T must be trivially copyable");
+  stream.write(reinterpret_cast<const char*>(&value), sizeof(value));
+}
+
+void writeStr(std::ostream& stream, const std::string& str) {
+  writeValue<uint16_t>(stream, str.size());
+  stream.write(str.data(), str.size());
+}
+
+std::string readStr(std::istream& stream) {
+  auto len = readValue<uint16_t>(stream);
+  std::string result(len, '\0');
+  stream.read(result.data(), len);
+  return result;
+}
+
+} // namespace
+
+std::string compileCacheKey(PyCodeObject* code) {
+  return fmt::format(
+      "{}:{}:{}",
+      unicodeAsString(code->co_filename),
+      code->co_firstlineno,
+      codeQualname(code));
+}
+
+bool CompileCache::read(const std::string& filename) {
+  std::ifstream file(filename, std::ios::binary);
+  if (!file) {
+    // A missing cache is expected the first time a program runs.
+    JIT_DLOG("No compile cache at %s", filename);
+    return false;
+  }
+  if (read(file)) {
+    JIT_LOG(
+        "Loaded compile cache entries for %d code objects from %s",
+        entries_.size(),
+        filename);
+    return true;
+  }
+  return false;
+}
+
+bool CompileCache::read(std::istream& stream) {
+  UnorderedMap<std::string, Entry> entries;
+  size_t num_entries;
+  bool fingerprint_matches;
+  try {
+    stream.exceptions(std::ios::badbit | std::ios::failbit);
+    auto magic = readValue<uint64_t>(stream);
+    if (magic != kMagicHeader) {
+      JIT_LOG("Bad magic value %#x in compile cache stream", magic);
+      return false;
+    }
+    auto version = readValue<uint32_t>(stream);
+    if (version != kVersion) {
+      JIT_LOG("Unknown compile cache version %d", version);
+      return false;
+    }
+    fingerprint_matches = readStr(stream) == fingerprint_;
+    num_entries = readValue<uint32_t>(stream);
+    for (size_t i = 0; i < num_entries; ++i) {
+      std::string key = readStr(stream);
+      auto bc_hash = readValue<uint32_t>(stream);
+      auto result = readValue<uint8_t>(stream);
+      if (result > static_cast<uint8_t>(CompileCacheResult::kFailed)) {
+        JIT_LOG("Bad result %d in compile cache stream", result);
+        return false;
+      }
+      entries[key] = Entry{bc_hash, static_cast<CompileCacheResult>(result)};
+    }
+  } catch (const std::runtime_error& e) {
+    JIT_LOG("Failed to load compile cache from stream: %s", e.what());
+    return false;
+  }
+
+  if (!fingerprint_matches) {
+    JIT_LOG(
+        "Compile cache was written by a different build; dropping %d entries",
+        num_entries);
+    stats_.invalidations += num_entries;
+    return true;
+  }
+  // Entries recorded by this process are newer than anything on disk.
+  for (auto& [key, entry] : entries) {
+    entries_.emplace(key, entry);
+  }
+  return true;
+}
+
+bool CompileCache::write(const std::string& filename) {
+  // Write to a private temporary file and rename it into place, so readers
+  // never see a partially written cache.
+  std::string tmp_filename = fmt::format("{}.{}.tmp", filename, getpid());
+  {
+    std::ofstream file(tmp_filename, std::ios::binary);
+    if (!file) {
+      JIT_LOG("Failed to open %s for writing", tmp_filename);
+      return false;
+    }
+    if (!write(file)) {
+      std::remove(tmp_filename.c_str());
+      return false;
+    }
+  }
+  if (std::rename(tmp_filename.c_str(), filename.c_str()) != 0) {
+    JIT_LOG("Failed to rename %s to %s", tmp_filename, filename);
+    std::remove(tmp_filename.c_str());
+    return false;
+  }
+  JIT_LOG(
+      "Wrote compile cache entries for %d code objects to %s",
+      entries_.size(),
+      filename);
+  return true;
+}
+
+bool CompileCache::write(std::ostream& stream) {
+  try {
+    stream.exceptions(std::ios::badbit | std::ios::failbit);
+    writeValue<uint64_t>(stream, kMagicHeader);
+    writeValue<uint32_t>(stream, kVersion);
+    writeStr(stream, fingerprint_);
+    writeValue<uint32_t>(stream, entries_.size());
+    for (auto& [key, entry] : entries_) {
+      writeStr(stream, key);
+      writeValue<uint32_t>(stream, entry.bc_hash);
+      writeValue<uint8_t>(stream, static_cast<uint8_t>(entry.result));
+    }
+  } catch (const std::runtime_error& e) {
+    JIT_LOG("Failed to write compile cache to stream: %s", e.what());
+    return false;
+  }
+
+  dirty_ = false;
+  return true;
+}
+
+const CompileCache::Entry* CompileCache::find(const std::string& key) const {
+  auto it = entries_.find(key);
+  return it == entries_.end() ? nullptr : &it->second;
+}
+
+std::optional<CompileCacheResult> CompileCache::lookup(PyCodeObject* code) {
+  std::string key = compileCacheKey(code);
+  const Entry* entry = find(key);
+  if (entry == nullptr) {
+    stats_.misses++;
+    return std::nullopt;
+  }
+  if (entry->bc_hash != hashBytecode(code)) {
+    // The function was edited since the entry was recorded.
+    stats_.invalidations++;
+    entries_.erase(key);
+    dirty_ = true;
+    return std::nullopt;
+  }
+  stats_.hits++;
+  return entry->result;
+}
+
+std::optional<CompileCacheResult> CompileCache::peek(PyCodeObject* code) const {
+  const Entry* entry = find(compileCacheKey(code));
+  if (entry == nullptr || entry->bc_hash != hashBytecode(code)) {
+    return std::nullopt;
+  }
+  return entry->result;
+}
+
+void CompileCache::record(PyCodeObject* code, CompileCacheResult result) {
+  Entry entry{hashBytecode(code), result};
+  auto [it, inserted] = entries_.emplace(compileCacheKey(code), entry);
+  if (!inserted) {
+    if (it->second.bc_hash == entry.bc_hash &&
+        it->second.result == entry.result) {
+      return;
+    }
+    it->second = entry;
+  }
+  dirty_ = true;
+}
+
+CompileCacheStats CompileCache::stats() const {
+  CompileCacheStats stats = stats_;
+  stats.entries = entries_.size();
+  return stats;
+}
+
+} // namespace jit
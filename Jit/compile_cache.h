@@ -0,0 +1,99 @@
+// Copyright (c) Facebook, Inc. and its affiliates. (http://www.facebook.com)
+#pragma once
+
+#include "Python.h"
+
+#include "Jit/containers.h"
+
+#include <cstddef>
+#include <cstdint>
+#include <istream>
+#include <optional>
+#include <ostream>
+#include <string>
+
+namespace jit {
+
+// The recorded outcome of compiling a code object.
+enum class CompileCacheResult : uint8_t {
+  kCompiled = 0,
+  kFailed = 1,
+};
+
+struct CompileCacheStats {
+  size_t hits{0};
+  size_t misses{0};
+  size_t invalidations{0};
+  size_t entries{0};
+};
+
+// Cache of compilation outcomes that persists across process restarts.
+//
+// Each entry is keyed by the location of a code object (filename, first line
+// and qualname) and records the hash of the bytecode it was made for, so an
+// edited function invalidates its entry rather than reusing it. The whole file
+// is tagged with a fingerprint of the Python build and the JIT options that
+// affect compilation; loading a file with a different fingerprint invalidates
+// every entry in it.
+//
+// The cache records whether compilation succeeded, not the generated code:
+// machine code embeds addresses of objects and runtime structures that only
+// exist in the process that compiled it. A hit lets the JIT skip functions it
+// is known to reject and compile known-good functions as soon as they're
+// first called.
+//
+// Binary format is defined in Jit/compile_cache_format.txt. All methods must
+// be called with the GIL held.
+class CompileCache {
+ public:
+  explicit CompileCache(std::string fingerprint)
+      : fingerprint_{std::move(fingerprint)} {}
+
+  // Load entries from the given filename or stream, returning true on success.
+  // Entries made under a different fingerprint are dropped and counted as
+  // invalidations.
+  bool read(const std::string& filename);
+  bool read(std::istream& stream);
+
+  // Write all entries to the given filename or stream, returning true on
+  // success. Writing to a filename replaces the file atomically, so several
+  // processes sharing a cache can't corrupt it.
+  bool write(const std::string& filename);
+  bool write(std::ostream& stream);
+
+  // Look up the outcome recorded for code, updating the hit/miss/invalidation
+  // counters. Returns nullopt if there is no valid entry.
+  std::optional<CompileCacheResult> lookup(PyCodeObject* code);
+
+  // Like lookup(), but without updating any counters.
+  std::optional<CompileCacheResult> peek(PyCodeObject* code) const;
+
+  // Record the outcome of compiling code.
+  void record(PyCodeObject* code, CompileCacheResult result);
+
+  // Returns true if entries were recorded since the cache was last read or
+  // written.
+  bool dirty() const {
+    return dirty_;
+  }
+
+  CompileCacheStats stats() const;
+
+ private:
+  struct Entry {
+    uint32_t bc_hash;
+    CompileCacheResult result;
+  };
+
+  const Entry* find(const std::string& key) const;
+
+  std::string fingerprint_;
+  UnorderedMap<std::string, Entry> entries_;
+  bool dirty_{false};
+  CompileCacheStats stats_;
+};
+
+// Return the key used to identify code in a CompileCache.
+std::string compileCacheKey(PyCodeObject* code);
+
+} // namespace jit
@@ -0,0 +1,200 @@
+// Copyright (c) Facebook, Inc. and its affiliates. (http://www.facebook.com)
+#include "Jit/compile_queue.h"
+
+#include "Jit/log.h"
+
+#include <algorithm>
+#include <new>
+
+namespace jit {
+
+namespace {
+int64_t elapsedUs(
+    CompileQueue::clock::time_point start,
+    CompileQueue::clock::time_point end) {
+  return std::chrono::duration_cast<std::chrono::microseconds>(end - start)
+      .count();
+}
+} // namespace
+
+CompileQueue::CompileQueue(size_t num_workers, CompileFunc compile)
+    : num_workers_{num_workers}, compile_{std::move(compile)} {
+  JIT_CHECK(num_workers_ > 0, "CompileQueue needs at least one worker");
+  stats_.workers = num_workers_;
+}
+
+CompileQueue::~CompileQueue() {
+  JIT_CHECK(
+      workers_.empty() && queue_.empty(),
+      "CompileQueue must be stopped before destruction");
+}
+
+bool CompileQueue::schedule(BorrowedRef<PyFunctionObject> func) {
+  std::lock_guard<std::mutex> lock{mutex_};
+  if (stopping_) {
+    return false;
+  }
+  if (!pending_.insert(func).second) {
+    return true;
+  }
+  Py_INCREF(func);
+  queue_.push_back({func, clock::now()});
+  stats_.enqueued++;
+  stats_.queue_depth = queue_.size();
+  stats_.max_queue_depth = std::max(stats_.max_queue_depth, queue_.size());
+  if (workers_.empty()) {
+    startWorkers();
+  }
+  work_cv_.notify_one();
+  return true;
+}
+
+void CompileQueue::startWorkers() {
+  JIT_DLOG("Starting %d background compile workers", num_workers_);
+  for (size_t i = 0; i < num_workers_; i++) {
+    workers_.emplace_back([this] { workerLoop(); });
+  }
+}
+
+void CompileQueue::workerLoop() {
+  for (;;) {
+    Item item;
+    {
+      std::unique_lock<std::mutex> lock{mutex_};
+      work_cv_.wait(lock, [&] { return stopping_ || !queue_.empty(); });
+      if (stopping_) {
+        return;
+      }
+      item = queue_.front();
+      queue_.pop_front();
+      stats_.queue_depth = queue_.size();
+      in_flight_++;
+    }
+    clock::time_point dequeue_time = clock::now();
+
+    PyGILState_STATE gil_state = PyGILState_Ensure();
+    bool stopping;
+    {
+      std::lock_guard<std::mutex> lock{mutex_};
+      stopping = stopping_;
+    }
+    _PyJIT_Result result = PYJIT_RESULT_CANNOT_SPECIALIZE;
+    if (!stopping) {
+      result = compile_(item.func);
+    }
+    clock::time_point install_time = clock::now();
+
+    {
+      std::lock_guard<std::mutex> lock{mutex_};
+      pending_.erase(item.func);
+      in_flight_--;
+      if (stopping) {
+        stats_.dropped++;
+      } else {
+        if (result == PYJIT_RESULT_OK) {
+          stats_.compiled++;
+        } else {
+          stats_.failed++;
+        }
+        int64_t queue_time = elapsedUs(item.enqueue_time, dequeue_time);
+        stats_.total_queue_time_us += queue_time;
+        stats_.max_queue_time_us =
+            std::max(stats_.max_queue_time_us, queue_time);
+        if (result == PYJIT_RESULT_OK) {
+          int64_t latency = elapsedUs(item.enqueue_time, install_time);
+          stats_.total_install_latency_us += latency;
+          stats_.max_install_latency_us =
+              std::max(stats_.max_install_latency_us, latency);
+        }
+      }
+    }
+    Py_DECREF(item.func);
+    PyGILState_Release(gil_state);
+    idle_cv_.notify_all();
+  }
+}
+
+void CompileQueue::drain() {
+  Py_BEGIN_ALLOW_THREADS;
+  {
+    std::unique_lock<std::mutex> lock{mutex_};
+    idle_cv_.wait(lock, [&] {
+      return workers_.empty() || (queue_.empty() && in_flight_ == 0);
+    });
+  }
+  Py_END_ALLOW_THREADS;
+}
+
+void CompileQueue::stop() {
+  std::vector<std::thread> workers;
+  {
+    std::lock_guard<std::mutex> lock{mutex_};
+    if (workers_.empty() && queue_.empty()) {
+      return;
+    }
+    stopping_ = true;
+    workers.swap(workers_);
+  }
+  work_cv_.notify_all();
+
+  // Workers may be waiting for the GIL to finish their current unit.
+  Py_BEGIN_ALLOW_THREADS;
+  for (std::thread& worker : workers) {
+    worker.join();
+  }
+  Py_END_ALLOW_THREADS;
+
+  std::deque<Item> leftover;
+  {
+    std::lock_guard<std::mutex> lock{mutex_};
+    leftover.swap(queue_);
+    for (const Item& item : leftover) {
+      pending_.erase(item.func);
+    }
+    stats_.dropped += leftover.size();
+    stats_.queue_depth = 0;
+    stopping_ = false;
+  }
+  for (const Item& item : leftover) {
+    Py_DECREF(item.func);
+  }
+  idle_cv_.notify_all();
+}
+
+void CompileQueue::afterForkChild() {
+  // Only the forking thread exists in the child, so the std::thread objects
+  // refer to threads that are gone and can be neither joined nor destroyed.
+  // The mutex and condition variables may have been held by one of them.
+  if (!workers_.empty()) {
+    new std::vector<std::thread>(std::move(workers_));
+    workers_.clear();
+  }
+  new (&mutex_) std::mutex();
+  new (&work_cv_) std::condition_variable();
+  new (&idle_cv_) std::condition_variable();
+
+  // Anything that was being compiled when we forked goes back in the queue,
+  // adopting the reference held by the vanished worker.
+  std::unordered_set<PyFunctionObject*> queued;
+  for (const Item& item : queue_) {
+    queued.insert(item.func);
+  }
+  for (PyFunctionObject* func : pending_) {
+    if (queued.count(func) == 0) {
+      queue_.push_front({func, clock::now()});
+    }
+  }
+  in_flight_ = 0;
+  stopping_ = false;
+  stats_.queue_depth = queue_.size();
+  if (!queue_.empty()) {
+    startWorkers();
+  }
+}
+
+CompileQueueStats CompileQueue::stats() {
+  std::lock_guard<std::mutex> lock{mutex_};
+  return stats_;
+}
+
+} // namespace jit
@@ -0,0 +1,104 @@
+// Copyright (c) Facebook, Inc. and its affiliates. (http://www.facebook.com)
+#pragma once
+
+#include "Python.h"
+
+#include "Jit/pyjit_result.h"
+#include "Jit/ref.h"
+#include "Jit/util.h"
+
+#include <chrono>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <unordered_set>
+#include <vector>
+
+namespace jit {
+
+// Counters describing the behavior of a CompileQueue. All times are in
+// microseconds.
+struct CompileQueueStats {
+  size_t workers{0};
+  size_t queue_depth{0};
+  size_t max_queue_depth{0};
+  size_t enqueued{0};
+  size_t compiled{0};
+  size_t failed{0};
+  size_t dropped{0};
+  int64_t total_queue_time_us{0};
+  int64_t max_queue_time_us{0};
+  int64_t total_install_latency_us{0};
+  int64_t max_install_latency_us{0};
+};
+
+// Queue of functions waiting to be compiled by a pool of background worker
+// threads. Used by auto-JIT so that the thread that notices a function is hot
+// can keep interpreting it rather than stalling for the whole compilation.
+//
+// Workers acquire the GIL around each compilation: unlike batch compilation
+// (see multithread_compile_all() in pyjit.cpp), other Python threads keep
+// running while the queue is active, so the compiler can't rely on them being
+// parked. The compile function is responsible for installing the compiled
+// entry point on success.
+//
+// Unless stated otherwise, methods must be called with the GIL held.
+class CompileQueue {
+ public:
+  using CompileFunc =
+      std::function<_PyJIT_Result(BorrowedRef<PyFunctionObject>)>;
+  using clock = std::chrono::steady_clock;
+
+  CompileQueue(size_t num_workers, CompileFunc compile);
+  ~CompileQueue();
+
+  // Queue func for compilation, starting the worker threads if necessary.
+  // Returns true if func was queued or is already waiting in the queue.
+  bool schedule(BorrowedRef<PyFunctionObject> func);
+
+  // Block until every queued function has been processed. The GIL is released
+  // while waiting.
+  void drain();
+
+  // Stop and join all worker threads, discarding any functions still in the
+  // queue. The GIL is released while joining. The queue may be restarted by a
+  // later call to schedule().
+  void stop();
+
+  // Forget about worker threads that didn't survive a fork().
+  void afterForkChild();
+
+  CompileQueueStats stats();
+
+ private:
+  DISALLOW_COPY_AND_ASSIGN(CompileQueue);
+
+  struct Item {
+    // Strong reference; only touched with the GIL held.
+    PyFunctionObject* func;
+    clock::time_point enqueue_time;
+  };
+
+  void startWorkers();
+  void workerLoop();
+
+  const size_t num_workers_;
+  CompileFunc compile_;
+
+  std::mutex mutex_;
+  std::condition_variable work_cv_;
+  std::condition_variable idle_cv_;
+  std::deque<Item> queue_;
+  std::unordered_set<PyFunctionObject*> pending_;
+  std::vector<std::thread> workers_;
+  size_t in_flight_{0};
+  bool stopping_{false};
+
+  CompileQueueStats stats_;
+};
+
+} // namespace jit
@@ -716,13 +716,20 @@ void HIRBuilder::emitProfiledTypes(
     stack_idx = bc_instr.oparg();
   }
   if (types.size() == 1) {
+    // Snapshot with the operands still on the stack so a failing guard
+    // resumes at, and is attributed to, the profiled instruction.
+    tc.frame.next_instr_offset = bc_instr.offset();
+    tc.snapshot();
     for (auto type : first_profile) {
       if (type != nullptr) {
         Register* value = tc.frame.stack.top(stack_idx);
-        tc.emit<GuardType>(value, Type::fromTypeExact(type), value);
+        auto guard =
+            tc.emit<GuardType>(value, Type::fromTypeExact(type), value);
+        guard->setGuiltyReg(value);
       }
       stack_idx--;
     }
+    tc.setCurrentInstr(bc_instr);
   } else {
     ProfiledTypes all_types;
     for (auto type_vec : types) {
@@ -1,10 +1,17 @@
 // Copyright (c) Facebook, Inc. and its affiliates. (http://www.facebook.com)
 #include "Jit/jit_context.h"
 
+#include "internal/pycore_shadow_frame.h"
+
+#include "Jit/code_allocator.h"
 #include "Jit/codegen/gen_asm.h"
 #include "Jit/jit_gdb_support.h"
 #include "Jit/log.h"
+#include "Jit/profile_data.h"
 #include "Jit/pyjit.h"
+#include "Jit/runtime.h"
+
+#include <unordered_set>
 
 static void deopt_func(_PyJITContext* ctx, BorrowedRef<PyFunctionObject> func) {
   if (ctx->compiled_funcs.erase(func) == 0) {
@@ -439,6 +446,127 @@ void _PyJITContext_TypeDestroyed(
   ctx->type_deopt.erase(type);
 }
 
+int _PyJITContext_ReclaimCode(_PyJITContext* ctx) {
+  JIT_CHECK(
+      !jit::g_threaded_compile_context.compileRunning(),
+      "Can't reclaim code during multithreaded compile");
+
+  // The CodeRuntime holds one reference to the code object, and every
+  // function, generator, or inlining caller that could still run the compiled
+  // code holds another.
+  std::unordered_set<PyObject*> dead_codes;
+  for (auto& entry : ctx->compiled_codes) {
+    if (Py_REFCNT(entry.first.code) == 1) {
+      dead_codes.insert(entry.first.code);
+    }
+  }
+  if (dead_codes.empty()) {
+    return 0;
+  }
+
+  // Frames keep their function alive through the caller, but check the stacks
+  // anyway rather than depend on that.
+  for (PyInterpreterState* interp = PyInterpreterState_Head();
+       interp != nullptr;
+       interp = PyInterpreterState_Next(interp)) {
+    for (PyThreadState* tstate = PyInterpreterState_ThreadHead(interp);
+         tstate != nullptr;
+         tstate = PyThreadState_Next(tstate)) {
+      for (_PyShadowFrame* sf = tstate->shadow_frame; sf != nullptr;
+           sf = sf->prev) {
+        dead_codes.erase(
+            reinterpret_cast<PyObject*>(_PyShadowFrame_GetCode(sf)));
+      }
+    }
+  }
+
+  std::vector<std::unique_ptr<jit::CompiledFunction>> reclaimed;
+  for (auto it = ctx->compiled_codes.begin();
+       it != ctx->compiled_codes.end();) {
+    if (dead_codes.count(it->first.code)) {
+      reclaimed.emplace_back(std::move(it->second));
+      it = ctx->compiled_codes.erase(it);
+    } else {
+      ++it;
+    }
+  }
+
+  // Releasing references can run arbitrary code, so only do it once
+  // compiled_codes is consistent again.
+  for (auto& compiled : reclaimed) {
+    jit::CodeAllocator::get()->releaseCode(
+        reinterpret_cast<void*>(compiled->entry_point()));
+    compiled->codeRuntime()->releaseReferences();
+  }
+  return reclaimed.size();
+}
+
+_PyJIT_Result _PyJITContext_RecompileForDeopts(
+    _PyJITContext* ctx,
+    jit::CodeRuntime* code_rt) {
+  JIT_CHECK(
+      !jit::g_threaded_compile_context.compileRunning(),
+      "Can't recompile code during multithreaded compile");
+
+  // code_rt may belong to code that has since been reclaimed or replaced, in
+  // which case its code object may be dead; look it up by address only.
+  const jit::RuntimeFrameState* frame_state = code_rt->frameState();
+  CompilationKey key{frame_state->code(), frame_state->globals()};
+  auto it = ctx->compiled_codes.find(key);
+  if (it == ctx->compiled_codes.end() ||
+      it->second->codeRuntime() != code_rt) {
+    return PYJIT_RESULT_CANNOT_SPECIALIZE;
+  }
+  BorrowedRef<PyCodeObject> code = frame_state->code();
+  BorrowedRef<PyDictObject> globals{frame_state->globals()};
+
+  std::vector<BorrowedRef<PyFunctionObject>> funcs;
+  for (BorrowedRef<PyFunctionObject> func : ctx->compiled_funcs) {
+    if (func->func_code == code && func->func_globals == globals) {
+      funcs.emplace_back(func);
+    }
+  }
+  if (funcs.empty()) {
+    return PYJIT_RESULT_CANNOT_SPECIALIZE;
+  }
+
+  jit::Runtime* runtime = jit::Runtime::get();
+  bool changed = false;
+  for (auto& [idx, stat] : runtime->deoptStats()) {
+    const jit::DeoptMetadata& meta = runtime->getDeoptMetadata(idx);
+    if (meta.code_rt == code_rt) {
+      changed |= jit::addDeoptProfiles(meta, stat);
+    }
+  }
+  if (!changed) {
+    return PYJIT_RESULT_CANNOT_SPECIALIZE;
+  }
+
+  std::unique_ptr<jit::CompiledFunction> old_compiled = std::move(it->second);
+  ctx->compiled_codes.erase(it);
+  CompilationResult result =
+      compileCode(ctx, code, globals, jit::funcFullname(funcs[0]));
+  if (result.compiled == nullptr) {
+    // Keep running the old code.
+    ctx->compiled_codes.emplace(key, std::move(old_compiled));
+    return result.result;
+  }
+
+  vectorcallfunc old_entry = old_compiled->entry_point();
+  vectorcallfunc new_entry = result.compiled->entry_point();
+  for (BorrowedRef<PyFunctionObject> func : funcs) {
+    if (func->vectorcall == old_entry) {
+      func->vectorcall = new_entry;
+    }
+    runtime->rebindFunctionEntryCache(
+        func,
+        reinterpret_cast<void*>(JITRT_GET_STATIC_ENTRY(old_entry)),
+        reinterpret_cast<void*>(JITRT_GET_STATIC_ENTRY(new_entry)));
+  }
+  ctx->orphaned_compiled_codes.emplace_back(std::move(old_compiled));
+  return PYJIT_RESULT_OK;
+}
+
 int _PyJITContext_DidCompile(
     _PyJITContext* ctx,
     BorrowedRef<PyFunctionObject> func) {
@@ -88,8 +88,8 @@ struct _PyJITContext {
       compiled_codes;
 
   /*
-   * Code which is being kept alive in case it was in use when
-   * _PyJITContext_ClearCache was called. Only intended to be used during
+   * Code which is being kept alive in case it was in use when it was replaced,
+   * by _PyJITContext_RecompileForDeopts or by _PyJITContext_ClearCache during
    * multithreaded_compile_test.
    */
   std::vector<std::unique_ptr<jit::CompiledFunction>> orphaned_compiled_codes;
@@ -184,6 +184,37 @@ void _PyJITContext_TypeDestroyed(
     _PyJITContext* ctx,
     BorrowedRef<PyTypeObject> type);
 
+/*
+ * Free compiled code that can never run again: code whose code object is
+ * referenced only by the JIT (e.g. left behind when a module is reloaded) and
+ * that isn't on any thread's stack. The code's memory goes back to the code
+ * allocator and the references held by its CodeRuntime are dropped.
+ *
+ * Must be called with the GIL held, outside of multithreaded compile.
+ *
+ * Returns the number of compiled code objects that were freed.
+ */
+int _PyJITContext_ReclaimCode(_PyJITContext* ctx);
+
+/*
+ * Recompile the code that owns code_rt after its guards failed too often. The
+ * guilty types recorded in the runtime's deopt stats are added to the profile
+ * data behind the failing guards (see jit::addDeoptProfiles), so the new code
+ * no longer guards on a single type there. Functions running the old code,
+ * and their static entry point caches, are switched to the new code; the old
+ * code stays alive since it may still be on the stack or called directly from
+ * other compiled code.
+ *
+ * Must be called with the GIL held, outside of multithreaded compile.
+ *
+ * Returns PYJIT_RESULT_OK if the code was recompiled, and
+ * PYJIT_RESULT_CANNOT_SPECIALIZE if code_rt no longer belongs to installed code
+ * or none of its deopts came from profile data.
+ */
+_PyJIT_Result _PyJITContext_RecompileForDeopts(
+    _PyJITContext* ctx,
+    jit::CodeRuntime* code_rt);
+
 /*
  * Return whether or not this context compiled the supplied function.
  *
@@ -1874,6 +1874,9 @@ LIRGenerator::TranslatedBlock LIRGenerator::TranslateOneBasicBlock(
             "Can't statically invoke given function: %s",
             PyUnicode_AsUTF8(func->func_qualname));
         if (_PyJIT_IsCompiled((PyObject*)func)) {
+          // Keep the callee, and so its compiled code, alive for as long as
+          // we call it directly.
+          env_->code_rt->addReference(reinterpret_cast<PyObject*>(func));
           ss << fmt::format(
               "Call {}, {}",
               instr->dst(),
@@ -193,10 +193,11 @@ lir::Function* LIRInliner::parseFunction(uint64_t addr) {
   // addr_to_function maps function address to parsed function
   static UnorderedMap<uint64_t, std::unique_ptr<Function>>
       addr_to_function;
+  static ThreadedCompileLock addr_to_function_lock;
 
   {
     // Guard usage of addr_to_function
-    ThreadedCompileSerialize guard;
+    std::lock_guard<ThreadedCompileLock> guard{addr_to_function_lock};
 
     // Check if function has already been parsed.
     auto iter = addr_to_function.find(addr);
@@ -209,7 +210,7 @@ lir::Function* LIRInliner::parseFunction(uint64_t addr) {
   auto lir_text_iter = kCHelperMapping.find(addr);
   if (lir_text_iter == kCHelperMapping.end()) {
     // Guard usage of addr_to_function
-    ThreadedCompileSerialize guard;
+    std::lock_guard<ThreadedCompileLock> guard{addr_to_function_lock};
     // Add nullptr to map in case same addr is used again.
     addr_to_function.emplace(addr, nullptr);
     return nullptr; // No LIR text for that address.
@@ -221,14 +222,14 @@ lir::Function* LIRInliner::parseFunction(uint64_t addr) {
     parsed_func = parser.parse(lir_text_iter->second);
   } catch (const ParserException&) {
     // Guard usage of addr_to_function
-    ThreadedCompileSerialize guard;
+    std::lock_guard<ThreadedCompileLock> guard{addr_to_function_lock};
     // Add nullptr to map in case same addr is used again.
     addr_to_function.emplace(addr, nullptr);
     return nullptr;
   }
 
   // Guard usage of addr_to_function
-  ThreadedCompileSerialize guard;
+  std::lock_guard<ThreadedCompileLock> guard{addr_to_function_lock};
   // Add function to map.
   addr_to_function.emplace(addr, std::move(parsed_func));
   // Return parsed function.
@@ -1,5 +1,6 @@
 #include "Jit/profile_data.h"
 
+#include "Jit/bytecode.h"
 #include "Jit/codegen/gen_asm.h"
 #include "Jit/containers.h"
 #include "Jit/hir/type.h"
@@ -8,6 +9,7 @@
 
 #include <zlib.h>
 
+#include <algorithm>
 #include <fstream>
 #include <type_traits>
 
@@ -281,6 +283,71 @@ PolymorphicTypes getProfiledTypes(
   return ret;
 }
 
+bool addDeoptProfiles(const DeoptMetadata& meta, const DeoptStat& stat) {
+  if (meta.reason != DeoptReason::kGuardFailure || meta.guilty_value == -1 ||
+      stat.types.empty()) {
+    return false;
+  }
+  const DeoptFrameMetadata& frame = meta.frame_meta.at(meta.inline_depth);
+  auto code_it = s_profile_data.find(codeKey(frame.code));
+  if (code_it == s_profile_data.end()) {
+    return false;
+  }
+  // Profiled guards are emitted before their instruction, so they resume at
+  // its offset.
+  BytecodeOffset bc_off = frame.next_instr_offset;
+  auto prof_it = code_it->second.find(bc_off);
+  if (prof_it == code_it->second.end() || prof_it->second.empty()) {
+    return false;
+  }
+  PolymorphicProfiles& profiles = prof_it->second;
+  const std::vector<std::string>& first_profile = profiles[0];
+
+  // Find which operand was guarded, mirroring the stack layout used by
+  // HIRBuilder::emitProfiledTypes(): operands are profiled deepest first, and
+  // calls skip the callable.
+  ssize_t depth = -1;
+  for (size_t i = 0; i < frame.stack.size(); ++i) {
+    if (frame.stack[i] == meta.guilty_value) {
+      depth = frame.stack.size() - 1 - i;
+      break;
+    }
+  }
+  if (depth == -1) {
+    return false;
+  }
+  BytecodeInstruction bc_instr{
+      frame.code->co_rawcode,
+      static_cast<Py_ssize_t>(bc_off / sizeof(_Py_CODEUNIT))};
+  ssize_t first_idx = first_profile.size() - 1;
+  if (bc_instr.opcode() == CALL_FUNCTION) {
+    first_idx = bc_instr.oparg();
+  }
+  ssize_t operand = first_idx - depth;
+  if (operand < 0 || operand >= static_cast<ssize_t>(first_profile.size())) {
+    return false;
+  }
+
+  bool changed = false;
+  for (size_t i = 0; i < stat.types.size && stat.types.types[i] != nullptr;
+       ++i) {
+    if (profiles.size() >= kMegamorphicNumber) {
+      break;
+    }
+    BorrowedRef<PyTypeObject> type = stat.types.types[i];
+    std::vector<std::string> new_profile = first_profile;
+    new_profile[operand] = typeFullname(type);
+    if (std::find(profiles.begin(), profiles.end(), new_profile) !=
+        profiles.end()) {
+      continue;
+    }
+    s_live_types.insert(type);
+    profiles.emplace_back(std::move(new_profile));
+    changed = true;
+  }
+  return changed;
+}
+
 std::string codeKey(PyCodeObject* code) {
   const std::string filename = unicodeAsString(code->co_filename);
   const int firstlineno = code->co_firstlineno;
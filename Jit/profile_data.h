@@ -48,6 +48,12 @@ PolymorphicTypes getProfiledTypes(
     const CodeProfileData& data,
     BytecodeOffset bc_off);
 
+// Add the guilty types recorded for a failed GuardType to the profile that
+// produced the guard, making that profile polymorphic so a recompile won't
+// guard on a single type. Returns true if the profile data changed, and false
+// if the deopt didn't come from loaded profile data.
+bool addDeoptProfiles(const DeoptMetadata& meta, const DeoptStat& stat);
+
 // A CodeKey is an opaque value that uniquely identifies a specific code
 // object. It may include information about the name, file path, and contents
 // of the code object.
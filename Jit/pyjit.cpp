@@ -7,6 +7,8 @@
 #include "internal/pycore_shadow_frame.h"
 
 #include "Jit/code_allocator.h"
+#include "Jit/compile_cache.h"
+#include "Jit/compile_queue.h"
 #include "Jit/codegen/gen_asm.h"
 #include "Jit/containers.h"
 #include "Jit/frame.h"
@@ -29,6 +31,7 @@
 
 #include <dis-asm.h>
 
+#include <algorithm>
 #include <atomic>
 #include <chrono>
 #include <climits>
@@ -62,6 +65,9 @@ struct JitConfig {
   size_t cold_code_section_size{0};
   int hir_inliner_enabled{0};
   unsigned int auto_jit_threshold{0};
+  size_t auto_jit_compile_workers{0};
+  unsigned int auto_jit_loop_threshold{0};
+  size_t deopt_recompile_threshold{0};
 };
 static JitConfig jit_config;
 
@@ -89,6 +95,14 @@ unsigned int _PyJIT_GetJitConfigAuto_jit_threshold() {
   return jit_config.auto_jit_threshold;
 }
 
+size_t _PyJIT_GetJitConfigAuto_jit_compile_workers() {
+  return jit_config.auto_jit_compile_workers;
+}
+
+unsigned int _PyJIT_GetJitConfigAuto_jit_loop_threshold() {
+  return jit_config.auto_jit_loop_threshold;
+}
+
 namespace {
 // Extra information needed to compile a PyCodeObject.
 struct CodeData {
@@ -112,6 +126,13 @@ static std::unordered_set<BorrowedRef<>> jit_reg_units;
 static std::unordered_map<BorrowedRef<PyCodeObject>, CodeData> jit_code_data;
 // Every unit has an entry in preloaders if we are doing multithreaded compile.
 static std::unordered_map<BorrowedRef<>, hir::Preloader> jit_preloaders;
+// Background compilation of hot functions in auto-JIT mode, if enabled.
+static std::unique_ptr<CompileQueue> g_compile_queue;
+// Compilation outcomes persisted across runs, if enabled.
+static std::unique_ptr<CompileCache> g_compile_cache;
+// If non-empty, the compile cache will be written to this filename at
+// shutdown.
+static std::string g_compile_cache_file;
 
 namespace jit {
 bool isPreloaded(BorrowedRef<PyFunctionObject> func) {
@@ -129,6 +150,7 @@ const jit::hir::Preloader& getPreloader(BorrowedRef<PyFunctionObject> func) {
 
 static std::unordered_map<PyFunctionObject*, std::chrono::duration<double>>
     jit_time_functions;
+static ThreadedCompileLock jit_time_functions_lock;
 
 // If non-empty, profile information will be written to this filename at
 // shutdown.
@@ -173,7 +195,7 @@ struct CompilationTimer {
 
     double time = time_span.count();
     total_compliation_time += time;
-    jit::ThreadedCompileSerialize guard;
+    std::lock_guard<ThreadedCompileLock> guard{jit_time_functions_lock};
     jit_time_functions.emplace(func, time_span);
   }
 
@@ -181,8 +203,24 @@ struct CompilationTimer {
   BorrowedRef<PyFunctionObject> func{nullptr};
 };
 
+// Compiled code can only become unreachable once the functions using it are
+// gone, so look for code to reclaim before compiling something new after this
+// many compiled functions have been destroyed.
+static constexpr size_t kReclaimCodeInterval = 1000;
+static size_t g_compiled_funcs_destroyed = 0;
+
+// Code whose guards failed often enough that it should be recompiled, waiting
+// for processDeoptRecompiles() to run from the eval loop.
+static std::vector<CodeRuntime*> g_deopt_recompile_requests;
+static bool g_deopt_recompile_scheduled = false;
+static size_t g_deopt_recompiles_requested = 0;
+static size_t g_deopt_recompiles = 0;
+
+// Number of code objects marked hot by _PyJIT_MarkLoopHot().
+static size_t g_hot_loops = 0;
+
 static std::atomic<int> g_compile_workers_attempted;
-static int g_compile_workers_retries;
+static std::atomic<int> g_compile_workers_retries;
 
 void setJitLogFile(std::string log_filename) {
   // Redirect logging to a file if configured.
@@ -219,12 +257,14 @@ static jit::FlagProcessor xarg_flag_processor;
 static int use_jit = 0;
 static int jit_help = 0;
 static std::string write_profile_file;
+static std::string compile_cache_file;
 static int jit_profile_interp = 0;
 static std::string jl_fn;
 
 void initFlagProcessor() {
   use_jit = 0;
   write_profile_file = "";
+  compile_cache_file = "";
   jit_profile_interp = 0;
   jl_fn = "";
   jit_help = 0;
@@ -244,6 +284,43 @@ void initFlagProcessor() {
         "Enable auto-JIT mode, which compiles functions after the given "
         "threshold");
 
+    xarg_flag_processor
+        .addOption(
+            "jit-auto-compile-workers",
+            "PYTHONJITAUTOCOMPILEWORKERS",
+            [](size_t workers) {
+              if (use_jit) {
+                jit_config.auto_jit_compile_workers = workers;
+              }
+            },
+            "compile functions that reach the auto-JIT threshold on <COUNT> "
+            "background threads rather than on the calling thread")
+        .withFlagParamName("COUNT");
+
+    xarg_flag_processor
+        .addOption(
+            "jit-auto-loop-threshold",
+            "PYTHONJITAUTOLOOPTHRESHOLD",
+            [](unsigned int threshold) {
+              if (use_jit) {
+                jit_config.auto_jit_loop_threshold = threshold;
+              }
+            },
+            "in auto-JIT mode, also compile a function on its next call once "
+            "a single call has run <COUNT> loop iterations")
+        .withFlagParamName("COUNT");
+
+    xarg_flag_processor
+        .addOption(
+            "jit-deopt-recompile-threshold",
+            "PYTHONJITDEOPTRECOMPILETHRESHOLD",
+            [](size_t threshold) {
+              jit_config.deopt_recompile_threshold = threshold;
+            },
+            "recompile functions whose type guards have failed <COUNT> "
+            "times, treating the guilty types as extra profile data")
+        .withFlagParamName("COUNT");
+
     xarg_flag_processor.addOption(
         "jit-debug",
         "PYTHONJITDEBUG",
@@ -430,6 +507,14 @@ void initFlagProcessor() {
             "Write profiling data to <filename>")
         .withFlagParamName("filename");
 
+    xarg_flag_processor
+        .addOption(
+            "jit-compile-cache",
+            "PYTHONJITCOMPILECACHE",
+            compile_cache_file,
+            "Load and save a cache of compilation results in <filename>")
+        .withFlagParamName("filename");
+
     xarg_flag_processor.addOption(
         "jit-profile-interp",
         "PYTHONJITPROFILEINTERP",
@@ -601,20 +686,43 @@ static _PyJIT_Result compilePreloaded(BorrowedRef<> unit) {
   return _PyJITContext_CompilePreloader(jit_ctx, map_get(jit_preloaders, unit));
 }
 
-static void compile_worker_thread() {
+static void compile_worker_thread(size_t worker) {
   JIT_DLOG("Started compile worker in thread %d", std::this_thread::get_id());
+  g_threaded_compile_context.enterWorker(worker);
+  CompileWorkerStats& stats = g_threaded_compile_context.workerStats(worker);
   BorrowedRef<> unit;
-  while ((unit = g_threaded_compile_context.nextUnit()) != nullptr) {
+  while ((unit = g_threaded_compile_context.nextUnit(worker)) != nullptr) {
     g_compile_workers_attempted++;
-    if (compilePreloaded(unit) == PYJIT_RESULT_RETRY) {
-      ThreadedCompileSerialize guard;
+    auto start = std::chrono::steady_clock::now();
+    _PyJIT_Result result = compilePreloaded(unit);
+    stats.busy_time += std::chrono::steady_clock::now() - start;
+    if (result == PYJIT_RESULT_RETRY) {
       g_compile_workers_retries++;
       g_threaded_compile_context.retryUnit(unit);
+    } else {
+      stats.compiled++;
     }
   }
+  g_threaded_compile_context.exitWorker();
   JIT_DLOG("Finished compile worker in thread %d", std::this_thread::get_id());
 }
 
+// Estimate the relative cost of compiling a unit. Compile time grows with the
+// size of the bytecode, and profiled instructions get extra guards and
+// specialized code, so they count for more.
+static size_t compileCost(BorrowedRef<> unit) {
+  BorrowedRef<PyCodeObject> code = PyFunction_Check(unit)
+      ? BorrowedRef<PyCodeObject>{BorrowedRef<PyFunctionObject>{unit}
+                                      ->func_code}
+      : BorrowedRef<PyCodeObject>{unit};
+  constexpr size_t kProfiledInstrCost = 8;
+  size_t cost = PyBytes_GET_SIZE(code->co_code);
+  if (const CodeProfileData* data = getProfileData(code)) {
+    cost += data->size() * kProfiledInstrCost;
+  }
+  return cost;
+}
+
 static void multithread_compile_all() {
   JIT_CHECK(jit_ctx, "JIT not initialized");
 
@@ -641,6 +749,21 @@ static void multithread_compile_all() {
       }
     }
   }
+  // Start the most expensive units first, so a large function picked up near
+  // the end doesn't leave every other worker idle.
+  std::vector<std::pair<size_t, BorrowedRef<>>> costed_units;
+  costed_units.reserve(compilation_units.size());
+  for (BorrowedRef<> unit : compilation_units) {
+    costed_units.emplace_back(compileCost(unit), unit);
+  }
+  std::stable_sort(
+      costed_units.begin(), costed_units.end(), [](auto& a, auto& b) {
+        return a.first > b.first;
+      });
+  for (size_t i = 0; i < costed_units.size(); i++) {
+    compilation_units[i] = costed_units[i].second;
+  }
+
   // Disable checks for using GIL protected data across threads.
   // Conceptually what we're doing here is saying we're taking our own
   // responsibility for managing locking of CPython runtime data structures.
@@ -653,15 +776,16 @@ static void multithread_compile_all() {
   int old_gil_check_enabled = _PyGILState_check_enabled;
   _PyGILState_check_enabled = 0;
 
-  g_threaded_compile_context.startCompile(std::move(compilation_units));
-  std::vector<std::thread> worker_threads;
   JIT_CHECK(jit_config.batch_compile_workers, "Zero workers for compile");
+  g_threaded_compile_context.startCompile(
+      std::move(compilation_units), jit_config.batch_compile_workers);
+  std::vector<std::thread> worker_threads;
   {
     // Hold a lock while we create threads because IG production has magic to
     // wrap pthread_create() and run Python code before threads are created.
     ThreadedCompileSerialize guard;
     for (size_t i = 0; i < jit_config.batch_compile_workers; i++) {
-      worker_threads.emplace_back(compile_worker_thread);
+      worker_threads.emplace_back(compile_worker_thread, i);
     }
   }
   for (std::thread& worker_thread : worker_threads) {
@@ -677,6 +801,59 @@ static void multithread_compile_all() {
   jit_preloaders.clear();
 }
 
+// Compile a function that reached the auto-JIT threshold, on a CompileQueue
+// worker. On failure the function gets its normal interpreted entry point, just
+// as PyEntry_AutoJIT does when compiling synchronously.
+static _PyJIT_Result compileQueuedFunction(BorrowedRef<PyFunctionObject> func) {
+  _PyJIT_Result result = _PyJIT_CompileFunction(func);
+  if (result != PYJIT_RESULT_OK &&
+      func->vectorcall == (vectorcallfunc)_PyFunction_Vectorcall) {
+    func->vectorcall = (vectorcallfunc)PyEntry_LazyInit;
+    PyEntry_initnow(func);
+  }
+  return result;
+}
+
+// Recompile code whose guards failed too often. Runs as a pending call, since
+// the guard failures are noticed while deoptimizing, in the middle of running
+// the code being replaced.
+static int processDeoptRecompiles(void*) {
+  g_deopt_recompile_scheduled = false;
+  if (jit_ctx == nullptr || g_threaded_compile_context.compileRunning()) {
+    // Leave the requests for the next guard failure to schedule.
+    return 0;
+  }
+  std::vector<CodeRuntime*> requests = std::move(g_deopt_recompile_requests);
+  g_deopt_recompile_requests.clear();
+  for (CodeRuntime* code_rt : requests) {
+    if (_PyJITContext_RecompileForDeopts(jit_ctx, code_rt) == PYJIT_RESULT_OK) {
+      g_deopt_recompiles++;
+    }
+  }
+  return 0;
+}
+
+static void requestDeoptRecompile(CodeRuntime* code_rt) {
+  g_deopt_recompiles_requested++;
+  g_deopt_recompile_requests.emplace_back(code_rt);
+  if (!g_deopt_recompile_scheduled &&
+      Py_AddPendingCall(processDeoptRecompiles, nullptr) == 0) {
+    g_deopt_recompile_scheduled = true;
+  }
+}
+
+// Identify the Python build and the JIT options that can change whether a
+// function compiles, for tagging the compile cache.
+static std::string compileCacheFingerprint() {
+  return fmt::format(
+      "{}|{}|frame_mode={}|hir_inliner={}|lir_inliner={}",
+      Py_GetVersion(),
+      Py_GetBuildInfo(),
+      static_cast<int>(jit_config.frame_mode),
+      jit_config.hir_inliner_enabled,
+      !g_disable_lir_inliner);
+}
+
 static PyObject* multithreaded_compile_test(PyObject*, PyObject*) {
   if (!jit_config.multithreaded_compile_test) {
     PyErr_SetString(
@@ -697,6 +874,22 @@ static PyObject* multithreaded_compile_test(PyObject*, PyObject*) {
           .count(),
       g_compile_workers_attempted,
       g_compile_workers_retries);
+  const auto& worker_stats = g_threaded_compile_context.workerStats();
+  for (size_t i = 0; i < worker_stats.size(); i++) {
+    const CompileWorkerStats& stats = worker_stats[i];
+    auto to_ms = [](std::chrono::nanoseconds ns) {
+      return std::chrono::duration_cast<std::chrono::milliseconds>(ns).count();
+    };
+    JIT_LOG(
+        "Worker %d: compiled %d, steals %d, busy %d ms, idle %d ms, lock wait "
+        "%d ms",
+        i,
+        stats.compiled,
+        stats.steals,
+        to_ms(stats.busy_time),
+        to_ms(stats.idle_time),
+        to_ms(stats.lock_wait_time));
+  }
   Py_RETURN_NONE;
 }
 
@@ -743,10 +936,126 @@ disable_jit(PyObject* /* self */, PyObject* const* args, Py_ssize_t nargs) {
   Py_RETURN_NONE;
 }
 
+static PyObject* get_compile_queue_stats(PyObject*, PyObject*) {
+  if (g_compile_queue == nullptr) {
+    Py_RETURN_NONE;
+  }
+  CompileQueueStats queue_stats = g_compile_queue->stats();
+  auto stats = Ref<>::steal(PyDict_New());
+  if (stats == nullptr) {
+    return nullptr;
+  }
+  auto set_stat = [&](const char* name, int64_t value) {
+    auto value_obj = Ref<>::steal(PyLong_FromLongLong(value));
+    return value_obj != nullptr &&
+        PyDict_SetItemString(stats, name, value_obj) == 0;
+  };
+  if (!set_stat("workers", queue_stats.workers) ||
+      !set_stat("queue_depth", queue_stats.queue_depth) ||
+      !set_stat("max_queue_depth", queue_stats.max_queue_depth) ||
+      !set_stat("enqueued", queue_stats.enqueued) ||
+      !set_stat("compiled", queue_stats.compiled) ||
+      !set_stat("failed", queue_stats.failed) ||
+      !set_stat("dropped", queue_stats.dropped) ||
+      !set_stat("total_queue_time_us", queue_stats.total_queue_time_us) ||
+      !set_stat("max_queue_time_us", queue_stats.max_queue_time_us) ||
+      !set_stat(
+          "total_install_latency_us", queue_stats.total_install_latency_us) ||
+      !set_stat("max_install_latency_us", queue_stats.max_install_latency_us)) {
+    return nullptr;
+  }
+  return stats.release();
+}
+
+static PyObject* get_compile_cache_stats(PyObject*, PyObject*) {
+  if (g_compile_cache == nullptr) {
+    Py_RETURN_NONE;
+  }
+  CompileCacheStats cache_stats = g_compile_cache->stats();
+  auto stats = Ref<>::steal(PyDict_New());
+  if (stats == nullptr) {
+    return nullptr;
+  }
+  auto set_stat = [&](const char* name, size_t value) {
+    auto value_obj = Ref<>::steal(PyLong_FromSize_t(value));
+    return value_obj != nullptr &&
+        PyDict_SetItemString(stats, name, value_obj) == 0;
+  };
+  if (!set_stat("hits", cache_stats.hits) ||
+      !set_stat("misses", cache_stats.misses) ||
+      !set_stat("invalidations", cache_stats.invalidations) ||
+      !set_stat("entries", cache_stats.entries)) {
+    return nullptr;
+  }
+  return stats.release();
+}
+
+static PyObject* write_compile_cache(PyObject*, PyObject*) {
+  if (g_compile_cache == nullptr) {
+    Py_RETURN_FALSE;
+  }
+  if (!g_compile_cache->write(g_compile_cache_file)) {
+    PyErr_Format(
+        PyExc_OSError,
+        "Failed to write compile cache to %s",
+        g_compile_cache_file.c_str());
+    return nullptr;
+  }
+  Py_RETURN_TRUE;
+}
+
+static PyObject* drain_compile_queue(PyObject*, PyObject*) {
+  if (g_compile_queue != nullptr) {
+    g_compile_queue->drain();
+  }
+  Py_RETURN_NONE;
+}
+
+static PyObject* get_batch_compile_worker_stats(PyObject*, PyObject*) {
+  auto result = Ref<>::steal(PyDict_New());
+  if (result == nullptr) {
+    return nullptr;
+  }
+  auto set_int = [](BorrowedRef<> dict, const char* name, int64_t value) {
+    auto value_obj = Ref<>::steal(PyLong_FromLongLong(value));
+    return value_obj != nullptr &&
+        PyDict_SetItemString(dict, name, value_obj) == 0;
+  };
+  auto to_us = [](std::chrono::nanoseconds ns) {
+    return std::chrono::duration_cast<std::chrono::microseconds>(ns).count();
+  };
+  if (!set_int(result, "attempted", g_compile_workers_attempted) ||
+      !set_int(result, "retries", g_compile_workers_retries)) {
+    return nullptr;
+  }
+  auto workers = Ref<>::steal(PyList_New(0));
+  if (workers == nullptr ||
+      PyDict_SetItemString(result, "workers", workers) < 0) {
+    return nullptr;
+  }
+  for (const CompileWorkerStats& stats :
+       g_threaded_compile_context.workerStats()) {
+    auto worker = Ref<>::steal(PyDict_New());
+    if (worker == nullptr || !set_int(worker, "compiled", stats.compiled) ||
+        !set_int(worker, "steals", stats.steals) ||
+        !set_int(worker, "busy_time_us", to_us(stats.busy_time)) ||
+        !set_int(worker, "idle_time_us", to_us(stats.idle_time)) ||
+        !set_int(worker, "lock_wait_time_us", to_us(stats.lock_wait_time)) ||
+        PyList_Append(workers, worker) < 0) {
+      return nullptr;
+    }
+  }
+  return result.release();
+}
+
 static PyObject* get_batch_compilation_time_ms(PyObject*, PyObject*) {
   return PyLong_FromLong(g_batch_compilation_time_ms);
 }
 
+static PyObject* get_hot_loop_count(PyObject*, PyObject*) {
+  return PyLong_FromSize_t(g_hot_loops);
+}
+
 static PyObject* force_compile(PyObject* /* self */, PyObject* func) {
   if (!PyFunction_Check(func)) {
     PyErr_SetString(PyExc_TypeError, "force_compile expected a function");
@@ -1098,9 +1407,53 @@ static PyObject* get_allocator_stats(PyObject*, PyObject*) {
       PyDict_SetItemString(stats, "huge_allocs", huge_allocs) < 0) {
     return NULL;
   }
+  auto live_bytes =
+      Ref<>::steal(PyLong_FromSize_t(CodeAllocatorCinder::liveBytes()));
+  if (live_bytes == NULL ||
+      PyDict_SetItemString(stats, "live_bytes", live_bytes) < 0) {
+    return NULL;
+  }
+  auto freed_bytes =
+      Ref<>::steal(PyLong_FromSize_t(CodeAllocatorCinder::freedBytes()));
+  if (freed_bytes == NULL ||
+      PyDict_SetItemString(stats, "freed_bytes", freed_bytes) < 0) {
+    return NULL;
+  }
+  auto fragmented_bytes =
+      Ref<>::steal(PyLong_FromSize_t(CodeAllocatorCinder::fragmentedBytes()));
+  if (fragmented_bytes == NULL ||
+      PyDict_SetItemString(stats, "fragmented_bytes", fragmented_bytes) < 0) {
+    return NULL;
+  }
   return stats.release();
 }
 
+static PyObject* get_deopt_recompile_stats(PyObject*, PyObject*) {
+  auto stats = Ref<>::steal(PyDict_New());
+  if (stats == nullptr) {
+    return nullptr;
+  }
+  auto set_stat = [&](const char* name, size_t value) {
+    auto value_obj = Ref<>::steal(PyLong_FromSize_t(value));
+    return value_obj != nullptr &&
+        PyDict_SetItemString(stats, name, value_obj) == 0;
+  };
+  if (!set_stat("requested", g_deopt_recompiles_requested) ||
+      !set_stat("recompiled", g_deopt_recompiles) ||
+      !set_stat("pending", g_deopt_recompile_requests.size())) {
+    return nullptr;
+  }
+  return stats.release();
+}
+
+static PyObject* reclaim_code_memory(PyObject*, PyObject*) {
+  if (jit_ctx == nullptr) {
+    return PyLong_FromLong(0);
+  }
+  g_compiled_funcs_destroyed = 0;
+  return PyLong_FromLong(_PyJITContext_ReclaimCode(jit_ctx));
+}
+
 static PyObject* is_hir_inliner_enabled(PyObject* /* self */, PyObject*) {
   int result = _PyJIT_IsHIRInlinerEnabled();
   if (result) {
@@ -1202,10 +1555,51 @@ static PyMethodDef jit_methods[] = {
      METH_NOARGS,
      "Return the number of milliseconds spent in batch compilation when "
      "disabling the JIT."},
+    {"get_compile_queue_stats",
+     get_compile_queue_stats,
+     METH_NOARGS,
+     "Return stats from the background auto-JIT compile queue as a "
+     "dictionary, or None if background compilation is disabled."},
+    {"get_compile_cache_stats",
+     get_compile_cache_stats,
+     METH_NOARGS,
+     "Return hit, miss, invalidation and entry counts from the compile cache "
+     "as a dictionary, or None if the compile cache is disabled."},
+    {"write_compile_cache",
+     write_compile_cache,
+     METH_NOARGS,
+     "Write the compile cache to its file now rather than at shutdown, for "
+     "processes that exit without finalizing. Returns False if the compile "
+     "cache is disabled."},
+    {"drain_compile_queue",
+     drain_compile_queue,
+     METH_NOARGS,
+     "Block until every function queued for background compilation has been "
+     "processed."},
+    {"get_batch_compile_worker_stats",
+     get_batch_compile_worker_stats,
+     METH_NOARGS,
+     "Return attempt and retry counts and per-worker stats from the most "
+     "recent multithreaded batch compile."},
     {"get_allocator_stats",
      get_allocator_stats,
      METH_NOARGS,
      "Return stats from the code allocator as a dictionary."},
+    {"get_deopt_recompile_stats",
+     get_deopt_recompile_stats,
+     METH_NOARGS,
+     "Return how many recompiles were requested because of failing guards, "
+     "how many were done, and how many are pending, as a dictionary."},
+    {"get_hot_loop_count",
+     get_hot_loop_count,
+     METH_NOARGS,
+     "Return how many code objects were marked for compilation because a "
+     "loop in them crossed the auto-JIT loop threshold."},
+    {"reclaim_code_memory",
+     reclaim_code_memory,
+     METH_NOARGS,
+     "Free compiled code that can no longer run, such as code from reloaded "
+     "modules. Returns the number of compiled code objects freed."},
     {"is_hir_inliner_enabled",
      is_hir_inliner_enabled,
      METH_NOARGS,
@@ -1353,6 +1747,23 @@ int _PyJIT_Initialize() {
 
   total_compliation_time = 0.0;
 
+  if (!compile_cache_file.empty()) {
+    g_compile_cache = std::make_unique<CompileCache>(compileCacheFingerprint());
+    g_compile_cache->read(compile_cache_file);
+    g_compile_cache_file = compile_cache_file;
+  }
+
+  if (jit_config.auto_jit_threshold > 0 &&
+      jit_config.auto_jit_compile_workers > 0) {
+    g_compile_queue = std::make_unique<CompileQueue>(
+        jit_config.auto_jit_compile_workers, compileQueuedFunction);
+  }
+
+  if (jit_config.deopt_recompile_threshold > 0) {
+    Runtime::get()->setDeoptRecompileCallback(
+        jit_config.deopt_recompile_threshold, requestDeoptRecompile);
+  }
+
   return 0;
 }
 
@@ -1366,6 +1777,9 @@ int _PyJIT_IsEnabled() {
 
 void _PyJIT_AfterFork_Child() {
   perf::afterForkChild();
+  if (g_compile_queue != nullptr) {
+    g_compile_queue->afterForkChild();
+  }
 }
 
 int _PyJIT_AreTypeSlotsEnabled() {
@@ -1381,6 +1795,33 @@ int _PyJIT_IsAutoJITEnabled() {
   return _PyJIT_AutoJITThreshold() > 0;
 }
 
+unsigned int _PyJIT_AutoJITLoopThreshold() {
+  if (jit_config.auto_jit_threshold == 0) {
+    return 0;
+  }
+  return jit_config.auto_jit_loop_threshold;
+}
+
+void _PyJIT_MarkLoopHot(PyCodeObject* code) {
+  if (code->co_cache.ncalls < jit_config.auto_jit_threshold) {
+    code->co_cache.ncalls = jit_config.auto_jit_threshold;
+    g_hot_loops++;
+  }
+}
+
+int _PyJIT_ScheduleCompile(PyFunctionObject* func) {
+  if (g_compile_queue == nullptr || !_PyJIT_IsEnabled()) {
+    return 0;
+  }
+  return g_compile_queue->schedule(func);
+}
+
+void _PyJIT_StopCompileWorkers() {
+  if (g_compile_queue != nullptr) {
+    g_compile_queue->stop();
+  }
+}
+
 void _PyJIT_EnableHIRInliner() {
   jit_config.hir_inliner_enabled = 1;
 }
@@ -1458,9 +1899,32 @@ _PyJIT_Result _PyJIT_CompileFunction(PyFunctionObject* func) {
     return PYJIT_RESULT_CANNOT_SPECIALIZE;
   }
 
+  if (g_compiled_funcs_destroyed >= kReclaimCodeInterval) {
+    g_compiled_funcs_destroyed = 0;
+    _PyJITContext_ReclaimCode(jit_ctx);
+  }
+
+  BorrowedRef<PyCodeObject> code = func->func_code;
+  if (g_compile_cache != nullptr &&
+      g_compile_cache->lookup(code) == CompileCacheResult::kFailed) {
+    return PYJIT_RESULT_CANNOT_SPECIALIZE;
+  }
+
   CompilationTimer timer(func);
   jit_reg_units.erase(reinterpret_cast<PyObject*>(func));
-  return _PyJITContext_CompileFunction(jit_ctx, func);
+  _PyJIT_Result result = _PyJITContext_CompileFunction(jit_ctx, func);
+  if (g_compile_cache != nullptr && result != PYJIT_RESULT_RETRY) {
+    g_compile_cache->record(
+        code,
+        result == PYJIT_RESULT_OK ? CompileCacheResult::kCompiled
+                                  : CompileCacheResult::kFailed);
+  }
+  return result;
+}
+
+int _PyJIT_IsCompileCached(PyCodeObject* code) {
+  return g_compile_cache != nullptr &&
+      g_compile_cache->peek(code) == CompileCacheResult::kCompiled;
 }
 
 // Recursively search the given co_consts tuple for any code objects that are
@@ -1569,6 +2033,9 @@ void _PyJIT_FuncDestroyed(PyFunctionObject* func) {
     jit_reg_units.erase(reinterpret_cast<PyObject*>(func));
   }
   if (jit_ctx) {
+    if (_PyJITContext_DidCompile(jit_ctx, func) == 1) {
+      g_compiled_funcs_destroyed++;
+    }
     _PyJITContext_FuncDestroyed(jit_ctx, func);
   }
 }
@@ -1595,6 +2062,10 @@ static void dump_jit_stats() {
 }
 
 int _PyJIT_Finalize() {
+  // Background workers may be in the middle of a compilation.
+  _PyJIT_StopCompileWorkers();
+  g_compile_queue.reset();
+
   if (g_dump_stats) {
     dump_jit_stats();
   }
@@ -1605,9 +2076,19 @@ int _PyJIT_Finalize() {
   }
   clearProfileData();
 
+  if (g_compile_cache != nullptr) {
+    if (g_compile_cache->dirty()) {
+      g_compile_cache->write(g_compile_cache_file);
+    }
+    g_compile_cache.reset();
+    g_compile_cache_file.clear();
+  }
+
   // Always release references from Runtime objects: C++ clients may have
   // invoked the JIT directly without initializing a full _PyJITContext.
   jit::Runtime::get()->clearDeoptStats();
+  jit::Runtime::get()->setDeoptRecompileCallback(0, nullptr);
+  g_deopt_recompile_requests.clear();
   jit::Runtime::get()->releaseReferences();
 
   if (jit_config.init_state == JIT_INITIALIZED) {
@@ -29,6 +29,8 @@ PyAPI_FUNC(int) _PyJIT_IsJitConfigAllow_jit_list_wildcards(void);
 PyAPI_FUNC(int) _PyJIT_IsJitConfigCompile_all_static_functions(void);
 PyAPI_FUNC(size_t) _PyJIT_GetJitConfigBatch_compile_workers(void);
 PyAPI_FUNC(int) _PyJIT_IsJitConfigMultithreaded_compile_test(void);
+PyAPI_FUNC(size_t) _PyJIT_GetJitConfigAuto_jit_compile_workers(void);
+PyAPI_FUNC(unsigned int) _PyJIT_GetJitConfigAuto_jit_loop_threshold(void);
 
 /*
  * Offset of the code object within a jit::CodeRuntime
@@ -97,6 +99,37 @@ PyAPI_FUNC(int) _PyJIT_IsAutoJITEnabled(void);
  */
 PyAPI_FUNC(unsigned int) _PyJIT_AutoJITThreshold(void);
 
+/*
+ * Returns the number of loop back-edges one activation of a function may take
+ * before the function is treated as hot, or 0 if back-edges don't count
+ * toward auto-JIT.
+ */
+PyAPI_FUNC(unsigned int) _PyJIT_AutoJITLoopThreshold(void);
+
+/*
+ * Called by the interpreter when a loop in code crosses the auto-JIT loop
+ * threshold. Raises the call count of code to the auto-JIT threshold, so the
+ * next call of a function using it is compiled.
+ */
+PyAPI_FUNC(void) _PyJIT_MarkLoopHot(PyCodeObject* code);
+
+/*
+ * Queue func to be compiled by a background worker thread, which will patch
+ * its entry point once compilation finishes.
+ *
+ * Returns 1 if func was queued (or was already queued), and 0 if background
+ * compilation is not enabled, in which case the caller should compile func
+ * itself.
+ */
+PyAPI_FUNC(int) _PyJIT_ScheduleCompile(PyFunctionObject* func);
+
+/*
+ * Stop any background compile workers, dropping functions still waiting to be
+ * compiled. Must be called during shutdown while other threads can still
+ * acquire the GIL.
+ */
+PyAPI_FUNC(void) _PyJIT_StopCompileWorkers(void);
+
 /*
    Enable the HIR inliner.
  */
@@ -150,6 +183,13 @@ PyAPI_FUNC(_PyJIT_Result)
  */
 PyAPI_FUNC(_PyJIT_Result) _PyJIT_CompileFunction(PyFunctionObject* func);
 
+/*
+ * Returns 1 if the compile cache records that code compiled successfully in a
+ * previous run, and 0 otherwise. Auto-JIT uses this to compile such functions
+ * on their first call rather than waiting for them to reach the threshold.
+ */
+PyAPI_FUNC(int) _PyJIT_IsCompileCached(PyCodeObject* code);
+
 /*
  * Registers a function with the JIT to be compiled in the future.
  *
@@ -107,6 +107,17 @@ _PyTypedArgsInfo* Runtime::findFunctionPrimitiveArgInfo(
   return cache->second.arg_info.get();
 }
 
+void Runtime::rebindFunctionEntryCache(
+    PyFunctionObject* function,
+    void* old_entry,
+    void* new_entry) {
+  auto cache = function_entry_caches_.find(function);
+  if (cache != function_entry_caches_.end() &&
+      *cache->second.ptr_ == old_entry) {
+    *cache->second.ptr_ = new_entry;
+  }
+}
+
 void Runtime::forgetLoadGlobalCache(GlobalCache cache) {
   auto it = global_caches_.find(cache.key());
   orphaned_global_caches_.emplace_back(std::move(it->second));
@@ -132,6 +143,15 @@ void Runtime::recordDeopt(std::size_t idx, PyObject* guilty_value) {
   if (guilty_value != nullptr) {
     stat.types.recordType(Py_TYPE(guilty_value));
   }
+
+  if (deopt_recompile_threshold_ == 0) {
+    return;
+  }
+  const DeoptMetadata& meta = deopt_metadata_[idx];
+  if (meta.reason == DeoptReason::kGuardFailure && meta.code_rt != nullptr &&
+      meta.code_rt->recordGuardFailure() == deopt_recompile_threshold_) {
+    deopt_recompile_callback_(meta.code_rt);
+  }
 }
 
 const DeoptStats& Runtime::deoptStats() const {
@@ -142,6 +162,13 @@ void Runtime::clearDeoptStats() {
   deopt_stats_.clear();
 }
 
+void Runtime::setDeoptRecompileCallback(
+    std::size_t threshold,
+    RecompileCallback cb) {
+  deopt_recompile_threshold_ = threshold;
+  deopt_recompile_callback_ = std::move(cb);
+}
+
 TypeProfiles& Runtime::typeProfiles() {
   return type_profiles_;
 }
@@ -260,6 +260,11 @@ class CodeRuntime {
     return &debug_info_;
   }
 
+  // Count a guard failure in this code, returning the new total.
+  std::size_t recordGuardFailure() {
+    return ++guard_failures_;
+  }
+
   static constexpr int64_t frameStateOffset() {
     return offsetof(CodeRuntime, frame_state_);
   }
@@ -283,6 +288,8 @@ class CodeRuntime {
   int frame_size_{-1};
 
   DebugInfo debug_info_;
+
+  std::size_t guard_failures_{0};
 };
 
 // Information about the runtime behavior of a single deopt point: how often
@@ -343,6 +350,13 @@ class Runtime {
   // Find a cache for the indirect static entry point for a function.
   void** findFunctionEntryCache(PyFunctionObject* function);
 
+  // If function has a static entry point cache holding old_entry, point it at
+  // new_entry instead.
+  void rebindFunctionEntryCache(
+      PyFunctionObject* function,
+      void* old_entry,
+      void* new_entry);
+
   // Gets information about the primitive arguments that a function
   // is typed to.  Typed object references are explicitly excluded.
   _PyTypedArgsInfo* findFunctionPrimitiveArgInfo(PyFunctionObject* function);
@@ -365,6 +379,13 @@ class Runtime {
   const DeoptStats& deoptStats() const;
   void clearDeoptStats();
 
+  using RecompileCallback = std::function<void(CodeRuntime*)>;
+
+  // Call cb with the CodeRuntime of any compiled code whose guards have failed
+  // threshold times, so it can be recompiled with better type information. A
+  // threshold of 0 disables the callback.
+  void setDeoptRecompileCallback(std::size_t threshold, RecompileCallback cb);
+
   TypeProfiles& typeProfiles();
 
   using GuardFailureCallback = std::function<void(const DeoptMetadata&)>;
@@ -403,6 +424,8 @@ class Runtime {
   std::vector<DeoptMetadata> deopt_metadata_;
   DeoptStats deopt_stats_;
   GuardFailureCallback guard_failure_callback_;
+  std::size_t deopt_recompile_threshold_{0};
+  RecompileCallback deopt_recompile_callback_;
 
   TypeProfiles type_profiles_;
 
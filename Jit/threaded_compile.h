@@ -5,56 +5,187 @@
 
 #include "Jit/ref.h"
 
+#include <algorithm>
+#include <atomic>
 #include <cassert>
+#include <chrono>
+#include <cstdint>
+#include <memory>
 #include <mutex>
 #include <vector>
 
 namespace jit {
 
+// Per-worker counters for the most recent threaded compile.
+struct CompileWorkerStats {
+  size_t compiled{0};
+  size_t steals{0};
+  // Time spent compiling units.
+  std::chrono::nanoseconds busy_time{0};
+  // Time spent waiting to acquire threaded-compile locks.
+  std::chrono::nanoseconds lock_wait_time{0};
+  // Wall time of the whole compile minus busy_time; computed by endCompile().
+  std::chrono::nanoseconds idle_time{0};
+};
+
+// A fixed sequence of units owned by one worker. The owner takes units from
+// the front while other workers steal from the back. Both ends live in a
+// single atomic word, so neither side needs a lock.
+class WorkDeque {
+ public:
+  void assign(std::vector<BorrowedRef<>>&& units) {
+    // Can't use JIT_CHECK because we're included by log.h
+    assert(units.size() <= UINT32_MAX);
+    units_ = std::move(units);
+    bounds_.store(pack(0, units_.size()), std::memory_order_release);
+  }
+
+  BorrowedRef<> popFront() {
+    uint64_t bounds = bounds_.load(std::memory_order_acquire);
+    for (;;) {
+      uint32_t head = headOf(bounds), tail = tailOf(bounds);
+      if (head == tail) {
+        return nullptr;
+      }
+      if (bounds_.compare_exchange_weak(
+              bounds, pack(head + 1, tail), std::memory_order_acq_rel)) {
+        return units_[head];
+      }
+    }
+  }
+
+  BorrowedRef<> stealBack() {
+    uint64_t bounds = bounds_.load(std::memory_order_acquire);
+    for (;;) {
+      uint32_t head = headOf(bounds), tail = tailOf(bounds);
+      if (head == tail) {
+        return nullptr;
+      }
+      if (bounds_.compare_exchange_weak(
+              bounds, pack(head, tail - 1), std::memory_order_acq_rel)) {
+        return units_[tail - 1];
+      }
+    }
+  }
+
+  size_t size() const {
+    uint64_t bounds = bounds_.load(std::memory_order_acquire);
+    return tailOf(bounds) - headOf(bounds);
+  }
+
+ private:
+  static uint64_t pack(uint32_t head, uint32_t tail) {
+    return (uint64_t{tail} << 32) | head;
+  }
+  static uint32_t headOf(uint64_t bounds) {
+    return static_cast<uint32_t>(bounds);
+  }
+  static uint32_t tailOf(uint64_t bounds) {
+    return static_cast<uint32_t>(bounds >> 32);
+  }
+
+  std::vector<BorrowedRef<>> units_;
+  std::atomic<uint64_t> bounds_{0};
+};
+
 // Threaded-compile state for the whole process.
 class ThreadedCompileContext {
  public:
-  void startCompile(std::vector<BorrowedRef<>>&& work_queue) {
+  // Start a threaded compile of the given units, which should be sorted by
+  // decreasing cost. Units are dealt round-robin to num_workers deques, so
+  // every worker starts on one of the most expensive units.
+  void startCompile(
+      std::vector<BorrowedRef<>>&& work_queue,
+      size_t num_workers) {
     // Can't use JIT_CHECK because we're included by log.h
     assert(!compile_running_);
-    work_queue_ = std::move(work_queue);
+    assert(num_workers > 0);
+    std::vector<std::vector<BorrowedRef<>>> per_worker(num_workers);
+    for (size_t i = 0; i < work_queue.size(); i++) {
+      per_worker[i % num_workers].emplace_back(work_queue[i]);
+    }
+    num_workers_ = num_workers;
+    deques_ = std::make_unique<WorkDeque[]>(num_workers);
+    for (size_t i = 0; i < num_workers; i++) {
+      deques_[i].assign(std::move(per_worker[i]));
+    }
+    worker_stats_.assign(num_workers, CompileWorkerStats{});
+    start_time_ = std::chrono::steady_clock::now();
     compile_running_ = true;
   }
 
   std::vector<BorrowedRef<>>&& endCompile() {
     compile_running_ = false;
+    auto wall_time = std::chrono::steady_clock::now() - start_time_;
+    for (CompileWorkerStats& stats : worker_stats_) {
+      stats.idle_time = std::max(
+          std::chrono::nanoseconds{0},
+          std::chrono::duration_cast<std::chrono::nanoseconds>(wall_time) -
+              stats.busy_time);
+    }
+    deques_.reset();
+    num_workers_ = 0;
     return std::move(retry_list_);
   }
 
-  BorrowedRef<> nextUnit() {
-    lock();
-    if (work_queue_.empty()) {
-      unlock();
-      return nullptr;
+  // Bind the calling thread to the given worker slot, for stats collection.
+  void enterWorker(size_t worker) {
+    current_worker_stats_ = &worker_stats_.at(worker);
+  }
+
+  void exitWorker() {
+    current_worker_stats_ = nullptr;
+  }
+
+  // Take the next unit for the given worker: first from its own deque, then
+  // by stealing from the other workers.
+  BorrowedRef<> nextUnit(size_t worker) {
+    if (BorrowedRef<> unit = deques_[worker].popFront()) {
+      return unit;
     }
-    BorrowedRef<> unit = std ::move(work_queue_.back());
-    work_queue_.pop_back();
-    unlock();
-    return unit;
+    for (size_t i = 1; i < num_workers_; i++) {
+      if (BorrowedRef<> unit =
+              deques_[(worker + i) % num_workers_].stealBack()) {
+        worker_stats_[worker].steals++;
+        return unit;
+      }
+    }
+    return nullptr;
   }
 
-  // Assumes we have the lock
   void retryUnit(BorrowedRef<> unit) {
-    lock();
+    std::lock_guard<std::mutex> guard{retry_mutex_};
     retry_list_.emplace_back(unit);
-    unlock();
   }
 
   bool compileRunning() const {
     return compile_running_;
   }
 
+  const std::vector<CompileWorkerStats>& workerStats() const {
+    return worker_stats_;
+  }
+
+  CompileWorkerStats& workerStats(size_t worker) {
+    return worker_stats_.at(worker);
+  }
+
+  // Record time the current worker thread, if any, spent waiting for a lock.
+  static void recordLockWait(std::chrono::steady_clock::duration wait) {
+    if (current_worker_stats_ != nullptr) {
+      current_worker_stats_->lock_wait_time +=
+          std::chrono::duration_cast<std::chrono::nanoseconds>(wait);
+    }
+  }
+
  private:
   friend class ThreadedCompileSerialize;
 
   void lock() {
-    if (compile_running_) {
+    if (compile_running_ && !mutex_.try_lock()) {
+      auto start = std::chrono::steady_clock::now();
       mutex_.lock();
+      recordLockWait(std::chrono::steady_clock::now() - start);
     }
   }
 
@@ -68,8 +199,13 @@ class ThreadedCompileContext {
   // This needs to be recursive because we allow recursive compilation via
   // jit::hir::tryRecursiveCompile
   std::recursive_mutex mutex_;
-  std::vector<BorrowedRef<>> work_queue_;
+  size_t num_workers_{0};
+  std::unique_ptr<WorkDeque[]> deques_;
+  std::mutex retry_mutex_;
   std::vector<BorrowedRef<>> retry_list_;
+  std::vector<CompileWorkerStats> worker_stats_;
+  std::chrono::steady_clock::time_point start_time_;
+  static inline thread_local CompileWorkerStats* current_worker_stats_{nullptr};
 };
 
 extern ThreadedCompileContext g_threaded_compile_context;
@@ -86,6 +222,33 @@ class ThreadedCompileSerialize {
   }
 };
 
+// A lock protecting one self-contained piece of JIT state (e.g. the code
+// allocator) that doesn't otherwise touch Python objects. Like
+// ThreadedCompileSerialize it is a no-op outside of threaded compile, but it
+// lets workers avoid contending on the global lock. Use with std::lock_guard.
+//
+// Code holding one of these must not acquire the global threaded-compile lock.
+class ThreadedCompileLock {
+ public:
+  void lock() {
+    if (g_threaded_compile_context.compileRunning() && !mutex_.try_lock()) {
+      auto start = std::chrono::steady_clock::now();
+      mutex_.lock();
+      ThreadedCompileContext::recordLockWait(
+          std::chrono::steady_clock::now() - start);
+    }
+  }
+
+  void unlock() {
+    if (g_threaded_compile_context.compileRunning()) {
+      mutex_.unlock();
+    }
+  }
+
+ private:
+  std::mutex mutex_;
+};
+
 // Acquire the global threaded-compile lock for the execution of an expression.
 #define THREADED_COMPILE_SERIALIZED_CALL(expr) \
   ([&]() {                                     \
@@ -984,6 +984,7 @@ _PyEval_EvalFrameDefault(PyFrameObject *f, int throwflag)
     PyCodeObject *co;
     _PyShadowFrame shadow_frame;
     Py_ssize_t profiled_instrs = 0;
+    unsigned int jit_loop_budget = 0;
 
     int lazy_imports = -1;
 
@@ -1353,6 +1354,16 @@ _PyEval_EvalFrameDefault(PyFrameObject *f, int throwflag)
     }
     /* facebook end t39538061 */
 
+    /* facebook begin */
+    /* Functions that are called rarely but loop for a long time, like request
+       loop drivers, never reach the auto-JIT call threshold. Count back-edges
+       so that they are compiled on their next call instead. */
+    if ((co->co_flags & CO_OPTIMIZED) &&
+        co->co_cache.ncalls < _PyJIT_AutoJITThreshold()) {
+        jit_loop_budget = _PyJIT_AutoJITLoopThreshold();
+    }
+    /* facebook end */
+
     names = co->co_names;
     consts = co->co_consts;
     fastlocals = f->f_localsplus;
@@ -3853,6 +3864,12 @@ main_loop:
 
         case TARGET(JUMP_ABSOLUTE): {
             PREDICTED(JUMP_ABSOLUTE);
+            /* facebook begin */
+            if (jit_loop_budget != 0 && (size_t)oparg < INSTR_OFFSET() &&
+                --jit_loop_budget == 0) {
+                _PyJIT_MarkLoopHot(co);
+            }
+            /* facebook end */
             JUMPTO(oparg);
 #if FAST_LOOPS
             /* Enabling this path speeds-up all while and for-loops by bypassing
@@ -8516,7 +8533,19 @@ PyEntry_AutoJIT(PyFunctionObject *func,
                 Py_ssize_t nargsf,
                 PyObject *kwnames) {
     PyCodeObject* code = (PyCodeObject*)func->func_code;
-    if (++(code->co_cache.ncalls) > _PyJIT_AutoJITThreshold()) {
+    unsigned int ncalls = ++(code->co_cache.ncalls);
+    if (ncalls == 1 && _PyJIT_IsCompileCached(code)) {
+        /* Known to be worth compiling from a previous run. */
+        ncalls = code->co_cache.ncalls = _PyJIT_AutoJITThreshold() + 1;
+    }
+    if (ncalls > _PyJIT_AutoJITThreshold()) {
+        if (_PyJIT_ScheduleCompile(func)) {
+            /* Keep interpreting until a background worker installs the
+               compiled entry point. */
+            func->vectorcall = (vectorcallfunc)_PyFunction_Vectorcall;
+            return _PyFunction_Vectorcall(
+                (PyObject *)func, stack, nargsf, kwnames);
+        }
         if (_PyJIT_CompileFunction(func) != PYJIT_RESULT_OK) {
             func->vectorcall = (vectorcallfunc)PyEntry_LazyInit;
             PyEntry_initnow(func);
@@ -1264,6 +1264,10 @@ _Py_FinalizeEx(int skip_cleanup)
 
     call_py_exitfuncs(interp);
 
+    /* Background JIT compile workers need the GIL to finish, so stop them
+       before other threads are prevented from taking it. */
+    _PyJIT_StopCompileWorkers();
+
     /* Copy the core config, PyInterpreterState_Delete() free
        the core config memory */
 #ifdef Py_REF_DEBUG
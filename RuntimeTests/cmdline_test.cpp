@@ -437,6 +437,50 @@ TEST_F(CmdLineTest, JITEnabledFlags_BatchCompileWorkers) {
       0);
 }
 
+TEST_F(CmdLineTest, JITEnabledFlags_AutoCompileWorkers) {
+  ASSERT_EQ(
+      try_flag_and_envvar_effect(
+          L"jit-auto-compile-workers=3",
+          "PYTHONJITAUTOCOMPILEWORKERS=3",
+          []() {},
+          []() { ASSERT_EQ(_PyJIT_GetJitConfigAuto_jit_compile_workers(), 0); },
+          false),
+      0);
+
+  ASSERT_EQ(
+      try_flag_and_envvar_effect(
+          L"jit-auto-compile-workers=3",
+          "PYTHONJITAUTOCOMPILEWORKERS=3",
+          []() {},
+          []() { ASSERT_EQ(_PyJIT_GetJitConfigAuto_jit_compile_workers(), 3); },
+          true),
+      0);
+}
+
+TEST_F(CmdLineTest, JITEnabledFlags_AutoLoopThreshold) {
+  ASSERT_EQ(
+      try_flag_and_envvar_effect(
+          L"jit-auto-loop-threshold=1000",
+          "PYTHONJITAUTOLOOPTHRESHOLD=1000",
+          []() {},
+          []() {
+            ASSERT_EQ(_PyJIT_GetJitConfigAuto_jit_loop_threshold(), 0);
+          },
+          false),
+      0);
+
+  ASSERT_EQ(
+      try_flag_and_envvar_effect(
+          L"jit-auto-loop-threshold=1000",
+          "PYTHONJITAUTOLOOPTHRESHOLD=1000",
+          []() {},
+          []() {
+            ASSERT_EQ(_PyJIT_GetJitConfigAuto_jit_loop_threshold(), 1000);
+          },
+          true),
+      0);
+}
+
 TEST_F(CmdLineTest, ASMSyntax) {
   // default when nothing defined is AT&T, covered in prvious test
   ASSERT_EQ(
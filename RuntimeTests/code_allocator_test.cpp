@@ -0,0 +1,64 @@
+// Copyright (c) Facebook, Inc. and its affiliates. (http://www.facebook.com)
+#include <gtest/gtest.h>
+
+#include "Jit/code_allocator.h"
+
+#include "RuntimeTests/fixtures.h"
+#include "RuntimeTests/testutil.h"
+
+using namespace jit;
+
+namespace {
+// Allocate a function made of num_nops nops followed by a ret.
+void* addNops(CodeAllocator* allocator, size_t num_nops) {
+  asmjit::CodeHolder code;
+  code.init(allocator->asmJitCodeInfo());
+  asmjit::x86::Assembler as(&code);
+  for (size_t i = 0; i < num_nops; i++) {
+    as.nop();
+  }
+  as.ret();
+  void* result = nullptr;
+  EXPECT_EQ(allocator->addCode(&result, &code), asmjit::kErrorOk);
+  return result;
+}
+} // namespace
+
+class CodeAllocatorCinderTest : public RuntimeTest {};
+
+TEST_F(CodeAllocatorCinderTest, ReusesAndCoalescesReleasedCode) {
+  auto allocator = dynamic_cast<CodeAllocatorCinder*>(CodeAllocator::get());
+  ASSERT_NE(allocator, nullptr) << "Expected the huge-page code allocator";
+
+  auto a = static_cast<uint8_t*>(addNops(allocator, 63));
+  auto b = static_cast<uint8_t*>(addNops(allocator, 63));
+  auto c = static_cast<uint8_t*>(addNops(allocator, 63));
+  ASSERT_EQ(b, a + 64);
+  ASSERT_EQ(c, b + 64);
+  size_t live_bytes = CodeAllocatorCinder::liveBytes();
+  size_t freed_bytes = CodeAllocatorCinder::freedBytes();
+
+  // Any address inside an allocation identifies it.
+  allocator->releaseCode(a + 10);
+  EXPECT_EQ(CodeAllocatorCinder::liveBytes(), live_bytes - 64);
+  EXPECT_EQ(CodeAllocatorCinder::freedBytes(), freed_bytes + 64);
+
+  // The freed block is reused by code that fits, and the leftover goes back
+  // on the free list.
+  auto d = static_cast<uint8_t*>(addNops(allocator, 31));
+  EXPECT_EQ(d, a);
+  EXPECT_EQ(CodeAllocatorCinder::freedBytes(), freed_bytes + 32);
+
+  // Releasing b merges it with the leftover from d, so a 96 byte function
+  // fits in the combined block.
+  allocator->releaseCode(b);
+  EXPECT_EQ(CodeAllocatorCinder::freedBytes(), freed_bytes + 96);
+  auto e = static_cast<uint8_t*>(addNops(allocator, 95));
+  EXPECT_EQ(e, a + 32);
+  EXPECT_EQ(CodeAllocatorCinder::freedBytes(), freed_bytes);
+
+  allocator->releaseCode(c);
+  allocator->releaseCode(d);
+  allocator->releaseCode(e);
+  EXPECT_EQ(CodeAllocatorCinder::liveBytes(), live_bytes - 192);
+}
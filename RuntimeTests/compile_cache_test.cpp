@@ -0,0 +1,124 @@
+// Copyright (c) Facebook, Inc. and its affiliates. (http://www.facebook.com)
+#include <gtest/gtest.h>
+
+#include "Jit/compile_cache.h"
+#include "Jit/ref.h"
+
+#include "RuntimeTests/fixtures.h"
+#include "RuntimeTests/testutil.h"
+
+#include <sstream>
+#include <vector>
+
+using namespace jit;
+
+class CompileCacheTest : public RuntimeTest {
+ public:
+  void TearDown() override {
+    codes_.clear();
+    RuntimeTest::TearDown();
+  }
+
+  PyCodeObject* getCode(const char* src, const char* name) {
+    Ref<PyFunctionObject> func(compileAndGet(src, name));
+    if (func == nullptr) {
+      return nullptr;
+    }
+    codes_.emplace_back(func->func_code);
+    return reinterpret_cast<PyCodeObject*>(codes_.back().get());
+  }
+
+  std::vector<Ref<>> codes_;
+};
+
+TEST_F(CompileCacheTest, RecordsAndLooksUpResults) {
+  const char* src = R"(
+def good():
+    return 1
+
+def bad():
+    return 2
+)";
+  PyCodeObject* good = getCode(src, "good");
+  ASSERT_NE(good, nullptr);
+  PyCodeObject* bad = getCode(src, "bad");
+  ASSERT_NE(bad, nullptr);
+
+  CompileCache cache{"fingerprint"};
+  EXPECT_EQ(cache.lookup(good), std::nullopt);
+  EXPECT_FALSE(cache.dirty());
+  cache.record(good, CompileCacheResult::kCompiled);
+  cache.record(bad, CompileCacheResult::kFailed);
+  EXPECT_TRUE(cache.dirty());
+  EXPECT_EQ(cache.lookup(good), CompileCacheResult::kCompiled);
+  EXPECT_EQ(cache.lookup(bad), CompileCacheResult::kFailed);
+  EXPECT_EQ(cache.peek(good), CompileCacheResult::kCompiled);
+
+  CompileCacheStats stats = cache.stats();
+  EXPECT_EQ(stats.hits, 2);
+  EXPECT_EQ(stats.misses, 1);
+  EXPECT_EQ(stats.invalidations, 0);
+  EXPECT_EQ(stats.entries, 2);
+}
+
+TEST_F(CompileCacheTest, RoundTripsThroughStream) {
+  const char* src = R"(
+def func():
+    return 1
+)";
+  PyCodeObject* code = getCode(src, "func");
+  ASSERT_NE(code, nullptr);
+
+  CompileCache cache{"fingerprint"};
+  cache.record(code, CompileCacheResult::kCompiled);
+  std::stringstream stream;
+  ASSERT_TRUE(cache.write(stream));
+  EXPECT_FALSE(cache.dirty());
+  std::string data = stream.str();
+
+  CompileCache same_build{"fingerprint"};
+  std::istringstream in{data};
+  ASSERT_TRUE(same_build.read(in));
+  EXPECT_EQ(same_build.lookup(code), CompileCacheResult::kCompiled);
+  EXPECT_EQ(same_build.stats().hits, 1);
+
+  // Every entry written by a different build is invalid.
+  CompileCache other_build{"other fingerprint"};
+  std::istringstream other_in{data};
+  ASSERT_TRUE(other_build.read(other_in));
+  EXPECT_EQ(other_build.lookup(code), std::nullopt);
+  CompileCacheStats stats = other_build.stats();
+  EXPECT_EQ(stats.invalidations, 1);
+  EXPECT_EQ(stats.misses, 1);
+  EXPECT_EQ(stats.entries, 0);
+
+  std::istringstream garbage{"not a compile cache"};
+  EXPECT_FALSE(other_build.read(garbage));
+}
+
+TEST_F(CompileCacheTest, InvalidatesEditedFunction) {
+  const char* src = R"(
+def func():
+    return 1
+)";
+  const char* edited_src = R"(
+def func():
+    x = 1
+    return x
+)";
+  PyCodeObject* code = getCode(src, "func");
+  ASSERT_NE(code, nullptr);
+  PyCodeObject* edited = getCode(edited_src, "func");
+  ASSERT_NE(edited, nullptr);
+
+  CompileCache cache{"fingerprint"};
+  cache.record(code, CompileCacheResult::kFailed);
+  EXPECT_EQ(cache.peek(edited), std::nullopt);
+  EXPECT_EQ(cache.lookup(edited), std::nullopt);
+  CompileCacheStats stats = cache.stats();
+  EXPECT_EQ(stats.invalidations, 1);
+  EXPECT_EQ(stats.entries, 0);
+
+  cache.record(edited, CompileCacheResult::kCompiled);
+  EXPECT_EQ(cache.lookup(edited), CompileCacheResult::kCompiled);
+}
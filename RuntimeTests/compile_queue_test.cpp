@@ -0,0 +1,94 @@
+// Copyright (c) Facebook, Inc. and its affiliates. (http://www.facebook.com)
+#include <gtest/gtest.h>
+
+#include "Jit/compile_queue.h"
+#include "Jit/jit_context.h"
+#include "Jit/ref.h"
+
+#include "RuntimeTests/fixtures.h"
+#include "RuntimeTests/testutil.h"
+
+#include <memory>
+
+using namespace jit;
+
+class CompileQueueTest : public RuntimeTest {
+ public:
+  void SetUp() override {
+    RuntimeTest::SetUp();
+    jit_ctx_ = new _PyJITContext();
+    queue_ = std::make_unique<CompileQueue>(
+        2, [this](BorrowedRef<PyFunctionObject> func) {
+          return _PyJITContext_CompileFunction(jit_ctx_, func);
+        });
+  }
+
+  void TearDown() override {
+    queue_->stop();
+    queue_.reset();
+    delete jit_ctx_;
+    jit_ctx_ = nullptr;
+    RuntimeTest::TearDown();
+  }
+
+  _PyJITContext* jit_ctx_;
+  std::unique_ptr<CompileQueue> queue_;
+};
+
+TEST_F(CompileQueueTest, CompilesAndInstallsInBackground) {
+  const char* src = R"(
+def func(a, b):
+    return a + b
+)";
+  Ref<PyFunctionObject> func(compileAndGet(src, "func"));
+  ASSERT_NE(func, nullptr);
+  vectorcallfunc old_entrypoint = func->vectorcall;
+
+  ASSERT_TRUE(queue_->schedule(func));
+  // Scheduling a function that's already waiting doesn't queue it twice.
+  ASSERT_TRUE(queue_->schedule(func));
+  queue_->drain();
+
+  EXPECT_EQ(_PyJITContext_DidCompile(jit_ctx_, func), 1);
+  EXPECT_NE(func->vectorcall, old_entrypoint);
+
+  CompileQueueStats stats = queue_->stats();
+  EXPECT_EQ(stats.workers, 2);
+  EXPECT_EQ(stats.enqueued, 1);
+  EXPECT_EQ(stats.compiled, 1);
+  EXPECT_EQ(stats.failed, 0);
+  EXPECT_EQ(stats.queue_depth, 0);
+  EXPECT_EQ(stats.max_queue_depth, 1);
+  EXPECT_GE(stats.total_install_latency_us, stats.total_queue_time_us);
+
+  auto result = Ref<>::steal(PyObject_CallFunction(func, "ii", 1, 2));
+  ASSERT_NE(result, nullptr);
+  EXPECT_EQ(PyLong_AsLong(result), 3);
+}
+
+TEST_F(CompileQueueTest, CountsFailedCompiles) {
+  const char* src = R"(
+def func():
+    return 1
+)";
+  Ref<PyFunctionObject> func(compileAndGet(src, "func"));
+  ASSERT_NE(func, nullptr);
+  PyCodeObject* code = reinterpret_cast<PyCodeObject*>(func->func_code);
+  code->co_flags |= CO_SUPPRESS_JIT;
+
+  ASSERT_TRUE(queue_->schedule(func));
+  queue_->drain();
+
+  EXPECT_EQ(_PyJITContext_DidCompile(jit_ctx_, func), 0);
+  CompileQueueStats stats = queue_->stats();
+  EXPECT_EQ(stats.compiled, 0);
+  EXPECT_EQ(stats.failed, 1);
+  EXPECT_EQ(stats.total_install_latency_us, 0);
+
+  // The queue can be restarted after being stopped.
+  queue_->stop();
+  code->co_flags &= ~CO_SUPPRESS_JIT;
+  ASSERT_TRUE(queue_->schedule(func));
+  queue_->drain();
+  EXPECT_EQ(_PyJITContext_DidCompile(jit_ctx_, func), 1);
+}
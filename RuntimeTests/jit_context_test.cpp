@@ -4,12 +4,15 @@
 #include "switchboard.h"
 
 #include "Jit/jit_context.h"
+#include "Jit/profile_data.h"
 #include "Jit/ref.h"
+#include "Jit/runtime.h"
 
 #include "RuntimeTests/fixtures.h"
 #include "RuntimeTests/testutil.h"
 
 #include <memory>
+#include <sstream>
 
 class PyJITContextTest : public RuntimeTest {
  public:
@@ -94,3 +97,82 @@ foo = "hello"
   Ref<PyObject> result(PyObject_Call(func, empty_tuple, nullptr));
   ASSERT_EQ(result, Py_None);
 }
+
+TEST_F(PyJITContextTest, ReclaimsCodeOnlyReferencedByJIT) {
+  const char* src = R"(
+def func():
+    return 12345
+)";
+  Ref<PyFunctionObject> func(compileAndGet(src, "func"));
+  ASSERT_NE(func.get(), nullptr) << "Failed creating func";
+  ASSERT_EQ(_PyJITContext_CompileFunction(jit_ctx_, func), PYJIT_RESULT_OK)
+      << "Failed compiling";
+  auto code_weakref = Ref<>::steal(PyWeakref_NewRef(func->func_code, nullptr));
+  ASSERT_NE(code_weakref, nullptr);
+
+  // The code can still run, so it must be kept.
+  EXPECT_EQ(_PyJITContext_ReclaimCode(jit_ctx_), 0);
+
+  func.reset();
+  ASSERT_TRUE(runCode("del func"));
+  EXPECT_EQ(_PyJITContext_ReclaimCode(jit_ctx_), 1);
+  // Releasing the JIT's references freed the code object.
+  EXPECT_EQ(PyWeakref_GetObject(code_weakref), Py_None);
+  EXPECT_EQ(_PyJITContext_ReclaimCode(jit_ctx_), 0);
+}
+
+static size_t countDeopts() {
+  size_t count = 0;
+  for (auto& [idx, stat] : jit::Runtime::get()->deoptStats()) {
+    count += stat.count;
+  }
+  return count;
+}
+
+TEST_F(PyJITContextTest, RecompilesWithGuiltyTypesAfterDeopts) {
+  const char* src = R"(
+def test(c, i):
+    return c[i]
+test((1, 2, 3), 1)
+)";
+  _PyThreadState_SetProfileInterpAll(1);
+  Ref<PyFunctionObject> func(compileAndGet(src, "test"));
+  _PyThreadState_SetProfileInterpAll(0);
+  ASSERT_NE(func.get(), nullptr) << "Failed creating func";
+  std::stringstream data;
+  ASSERT_TRUE(jit::writeProfileData(data));
+  data.seekg(0);
+  ASSERT_TRUE(jit::readProfileData(data));
+
+  ASSERT_EQ(_PyJITContext_CompileFunction(jit_ctx_, func), PYJIT_RESULT_OK)
+      << "Failed compiling";
+  jit::CodeRuntime* code_rt = nullptr;
+  jit::Runtime::get()->setDeoptRecompileCallback(
+      2, [&](jit::CodeRuntime* rt) { code_rt = rt; });
+  auto list = Ref<>::steal(Py_BuildValue("[iii]", 1, 2, 3));
+  ASSERT_NE(list, nullptr);
+  auto call = [&] {
+    auto result =
+        Ref<>::steal(PyObject_CallFunction(func, "Oi", list.get(), 1));
+    return result == nullptr ? -1 : PyLong_AsLong(result);
+  };
+  EXPECT_EQ(call(), 2);
+  EXPECT_EQ(code_rt, nullptr);
+  EXPECT_EQ(call(), 2);
+  jit::Runtime::get()->setDeoptRecompileCallback(0, nullptr);
+  ASSERT_NE(code_rt, nullptr);
+  EXPECT_EQ(countDeopts(), 2);
+
+  vectorcallfunc old_entrypoint = func->vectorcall;
+  ASSERT_EQ(
+      _PyJITContext_RecompileForDeopts(jit_ctx_, code_rt), PYJIT_RESULT_OK);
+  EXPECT_NE(func->vectorcall, old_entrypoint);
+  // The old code has been replaced, so asking again does nothing.
+  EXPECT_EQ(
+      _PyJITContext_RecompileForDeopts(jit_ctx_, code_rt),
+      PYJIT_RESULT_CANNOT_SPECIALIZE);
+
+  // Lists no longer fail a guard.
+  EXPECT_EQ(call(), 2);
+  EXPECT_EQ(countDeopts(), 2);
+}
@@ -0,0 +1,59 @@
+// Copyright (c) Facebook, Inc. and its affiliates. (http://www.facebook.com)
+#include <gtest/gtest.h>
+
+#include "Jit/ref.h"
+#include "Jit/threaded_compile.h"
+
+#include "RuntimeTests/fixtures.h"
+#include "RuntimeTests/testutil.h"
+
+#include <vector>
+
+using namespace jit;
+
+namespace {
+// The work queues never dereference their units, so tests can use fake
+// pointers.
+BorrowedRef<> fakeUnit(uintptr_t n) {
+  return reinterpret_cast<PyObject*>(n * 8);
+}
+} // namespace
+
+TEST(WorkDequeTest, PopsFromFrontAndStealsFromBack) {
+  WorkDeque deque;
+  deque.assign({fakeUnit(1), fakeUnit(2), fakeUnit(3), fakeUnit(4)});
+  EXPECT_EQ(deque.size(), 4);
+  EXPECT_EQ(deque.popFront(), fakeUnit(1));
+  EXPECT_EQ(deque.stealBack(), fakeUnit(4));
+  EXPECT_EQ(deque.stealBack(), fakeUnit(3));
+  EXPECT_EQ(deque.size(), 1);
+  EXPECT_EQ(deque.popFront(), fakeUnit(2));
+  EXPECT_EQ(deque.popFront(), nullptr);
+  EXPECT_EQ(deque.stealBack(), nullptr);
+}
+
+TEST(ThreadedCompileContextTest, DealsRoundRobinThenSteals) {
+  ThreadedCompileContext ctx;
+  ctx.startCompile({fakeUnit(1), fakeUnit(2), fakeUnit(3), fakeUnit(4)}, 2);
+  ASSERT_TRUE(ctx.compileRunning());
+
+  // Worker 0 owns units 1 and 3, worker 1 owns units 2 and 4.
+  EXPECT_EQ(ctx.nextUnit(0), fakeUnit(1));
+  EXPECT_EQ(ctx.nextUnit(0), fakeUnit(3));
+  // Worker 0 is out of work, so it steals the cheapest unit from worker 1.
+  EXPECT_EQ(ctx.nextUnit(0), fakeUnit(4));
+  EXPECT_EQ(ctx.nextUnit(1), fakeUnit(2));
+  EXPECT_EQ(ctx.nextUnit(1), nullptr);
+  EXPECT_EQ(ctx.nextUnit(0), nullptr);
+
+  ctx.retryUnit(fakeUnit(3));
+  std::vector<BorrowedRef<>> retries = ctx.endCompile();
+  EXPECT_FALSE(ctx.compileRunning());
+  ASSERT_EQ(retries.size(), 1);
+  EXPECT_EQ(retries[0], fakeUnit(3));
+
+  const std::vector<CompileWorkerStats>& stats = ctx.workerStats();
+  ASSERT_EQ(stats.size(), 2);
+  EXPECT_EQ(stats[0].steals, 1);
+  EXPECT_EQ(stats[1].steals, 0);
+}